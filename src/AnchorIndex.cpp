@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <AnchorIndex.hpp>
+#include <algorithm>
+
+// up to this number of anchors, the nodes are scanned with the all windows kernel rather than with the segment filter
+#define MAX_ANCHORS_FULL_SCAN 4
+
+AnchorIndex::AnchorIndex(const bkpt_dict_t& targetDictionary, size_t anchor_size, int max_nb_mis) : _anchor_size(anchor_size)
+{
+    _nb_segments = max_nb_mis + 1;
+    if (_nb_segments > (int) anchor_size) _nb_segments = anchor_size;
+
+    // segments of (almost) equal sizes covering the anchor
+    for (int s = 0; s <= _nb_segments; s++)
+    {
+        _segment_start.push_back((anchor_size * s) / _nb_segments);
+    }
+
+    for (bkpt_dict_t::const_iterator it = targetDictionary.begin(); it != targetDictionary.end(); ++it)
+    {
+        if (it->first.size() < anchor_size) continue;
+
+        int rank = _anchors.size();
+        _anchors.push_back(it->first.substr(0, anchor_size));
+        _packed_anchors.push_back(packed_seq_t(it->first.c_str(), anchor_size));
+        _targets.push_back(it->second);
+        _labels.push_back(it->second.second ? it->second.first + "_Rc" : it->second.first);
+
+        for (int s = 0; s < _nb_segments; s++)
+        {
+            _segments[segment_hash(s, it->first.c_str() + _segment_start[s])].push_back(rank);
+        }
+    }
+}
+
+// FNV-1a on the 5 low bits of the characters (identical for 'A' and 'a'), the segment number is the seed
+uint64_t AnchorIndex::segment_hash(int segment, const char* seq) const
+{
+    uint64_t h = 14695981039346656037ULL ^ (uint64_t) segment;
+    for (size_t i = _segment_start[segment]; i < _segment_start[segment+1]; i++, seq++)
+    {
+        h ^= (uint64_t) (*seq & 31);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool AnchorIndex::find_best_anchor(const char* seq, size_t seq_len, int nb_mis_allowed, int& position, int& nb_match, bkpt_t& target_id, const string* excluded_label) const
+{
+    int best_match = 0;
+    int min_match = _anchor_size - nb_mis_allowed;
+
+    if (seq_len < _anchor_size || _anchors.empty()) return false;
+
+    packed_seq_t packed_seq(seq, seq_len);
+    size_t nb_windows = seq_len - _anchor_size + 1;
+
+    if (_anchors.size() <= MAX_ANCHORS_FULL_SCAN)
+    {
+        vector<vector<int> > mis(_anchors.size());
+        for (size_t r = 0; r < _anchors.size(); r++)
+        {
+            if (excluded_label && _labels[r] == *excluded_label) continue;
+            all_windows_mismatches(packed_seq, seq, _packed_anchors[r], _anchors[r].c_str(), nb_mis_allowed, mis[r]);
+        }
+
+        for (size_t j = 0; j < nb_windows; j++)
+        {
+            for (size_t r = 0; r < _anchors.size(); r++)
+            {
+                if (mis[r].empty() || mis[r][j] > nb_mis_allowed) continue;
+
+                int nbmatch = _anchor_size - mis[r][j];
+                if (nbmatch > best_match && nbmatch >= min_match)
+                {
+                    target_id = _targets[r];
+                    position = j;
+                    best_match = nbmatch;
+                    if (nbmatch == (int) _anchor_size)
+                    {
+                        nb_match = best_match;
+                        return true;
+                    }
+                }
+            }
+        }
+
+        nb_match = best_match;
+        return best_match != 0;
+    }
+
+    vector<int> candidates;
+
+    for (size_t j = 0; j < nb_windows; j++)
+    {
+        // anchors sharing at least one segment with the window
+        candidates.clear();
+        for (int s = 0; s < _nb_segments; s++)
+        {
+            unordered_map<uint64_t, vector<int> >::const_iterator found = _segments.find(segment_hash(s, seq + j + _segment_start[s]));
+            if (found != _segments.end())
+            {
+                candidates.insert(candidates.end(), found->second.begin(), found->second.end());
+            }
+        }
+        if (candidates.empty()) continue;
+
+        // in the order of the dictionary, as the exhaustive scan
+        sort(candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+
+        for (vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+        {
+            if (excluded_label && _labels[*it] == *excluded_label) continue;
+
+            int nbmis = window_mismatches(packed_seq, seq, j, _packed_anchors[*it], _anchors[*it].c_str(), nb_mis_allowed);
+            if (nbmis > nb_mis_allowed) continue;
+
+            int nbmatch = _anchor_size - nbmis;
+            if (nbmatch > best_match && nbmatch >= min_match)
+            {
+                target_id = _targets[*it];
+                position = j;
+                best_match = nbmatch;
+                if (nbmatch == (int) _anchor_size)
+                {
+                    nb_match = best_match;
+                    return true;
+                }
+            }
+        }
+    }
+
+    nb_match = best_match;
+    return best_match != 0;
+}
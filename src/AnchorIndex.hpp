@@ -0,0 +1,79 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _AnchorIndex_HPP_
+#define _AnchorIndex_HPP_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <Utils.hpp>
+#include <HammingKernel.hpp>
+
+using namespace std;
+
+/**
+ * Index of the target anchors (the keys of a bkpt_dict_t), to find them in the contig nodes with up to nb_mis_allowed mismatches.
+ *
+ * Pigeonhole filter : each anchor is cut in nb_mis_allowed+1 segments, an occurrence with at most nb_mis_allowed mismatches contains at least one of them exactly.
+ * The segments are hashed on the 5 low bits of their characters : two characters identical for identNT (same letter, maybe not the same case) have the same hash.
+ * The candidates are then checked on the 2-bit packed forms (same count as identNT), so that the result is the same as comparing every window of the node with every anchor.
+ * With a few anchors only (eg. breakpoint mode), every window of the node is compared with each anchor by the bit-parallel kernel instead of the filter.
+ */
+class AnchorIndex
+{
+public:
+
+    /** Indexes the first anchor_size nt of the keys of targetDictionary (shorter keys are ignored), max_nb_mis is the maximal number of mismatches of the queries
+     */
+    AnchorIndex(const bkpt_dict_t& targetDictionary, size_t anchor_size, int max_nb_mis);
+
+    /**
+     * Looks for the best occurrence of an anchor in the sequence, with at most nb_mis_allowed mismatches (<= max_nb_mis).
+     * Same result as scanning the windows of the sequence from left to right and, for each window, the anchors in the iteration order of the dictionary,
+     * keeping the first one with the largest number of matches, and stopping at the first exact occurrence.
+     * If excluded_label is given, the anchors of this target (name, with the _Rc suffix for the reverse targets) are ignored, as if they were not in the dictionary.
+     * returns false if no anchor occurs
+     */
+    bool find_best_anchor(const char* seq, size_t seq_len, int nb_mis_allowed, int& position, int& nb_match, bkpt_t& target_id, const string* excluded_label = NULL) const;
+
+    size_t anchor_size() const { return _anchor_size; }
+    size_t nb_anchors() const { return _anchors.size(); }
+
+private:
+
+    uint64_t segment_hash(int segment, const char* seq) const;
+
+    size_t _anchor_size;
+    int _nb_segments;
+    vector<size_t> _segment_start; // segment s is [_segment_start[s], _segment_start[s+1])
+
+    // anchors in the iteration order of the dictionary
+    vector<string> _anchors;
+    vector<packed_seq_t> _packed_anchors;
+    vector<bkpt_t> _targets;
+    vector<string> _labels;
+
+    // hash of (segment, segment sequence) -> anchors having this segment
+    unordered_map<uint64_t, vector<int> > _segments;
+};
+
+#endif /* _AnchorIndex_HPP_ */
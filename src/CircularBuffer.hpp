@@ -10,117 +10,91 @@
 #define CircularBuffer_hpp
 
 #include <stdio.h>
-
-
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 
 
-
-template <typename elem_t>  class CircularBuffer
+// History of the last kmers of the scan (hetero and SNP modes) : kmer, in/out degrees and repeat bit of each kmer.
+// The fields are stored in separate arrays (the SNP observers walk on the kmers only), indexes are absolute positions
+// wrapped on the size of the buffer, a power of two, so that they can be incremented or decremented freely.
+template <typename kmer_t>  class CircularBuffer
 {
-
-	friend class itCB;
-	
 public:
 	
+	//def construc, empty until resize
+	CircularBuffer() : _tai(0), _mask(0) {}
+	
 	//constructor, len in power of two  : 2^powlen
-	CircularBuffer(int powlen) : _idx(this)
+	CircularBuffer(int powlen)
 	{
-		_tai   = (1LL << powlen);
-		_buffer = (elem_t* ) calloc(_tai,sizeof(elem_t));
-		_mask =  _tai -1;
+		resize(powlen);
 	}
 	
-	//def construc
-	CircularBuffer() : _idx(this)
+	void resize(int powlen)
 	{
-		int powlen = 10;
-		_tai   = (1LL << powlen);
-		_buffer = (elem_t* ) calloc(_tai,sizeof(elem_t));
+		_tai   = ((size_t)1 << powlen);
 		_mask =  _tai -1;
+		_kmers.resize(_tai);
+		_nb_in.resize(_tai);
+		_nb_out.resize(_tai);
+		_repeated.resize((_tai + 63) / 64);
+		clear();
 	}
 	
-	void resize(int powlen)
+	void clear()
 	{
-		_tai   = (1LL << powlen);
-		_buffer = (elem_t* ) realloc(_buffer,sizeof(elem_t)*_tai);
-		_mask =  _tai -1;
+		memset(&_kmers[0], 0, sizeof(kmer_t)*_tai);
+		memset(&_nb_in[0], 0, _tai);
+		memset(&_nb_out[0], 0, _tai);
+		memset(&_repeated[0], 0, sizeof(u_int64_t)*_repeated.size());
 	}
 	
+	size_t size() const { return _tai; }
+	
+	kmer_t& kmer(size_t idx) { return _kmers[idx & _mask]; }
+	
+	int nb_in(size_t idx) const { return _nb_in[idx & _mask]; }
 	
-	void push(elem_t new_elem)
+	int nb_out(size_t idx) const { return _nb_out[idx & _mask]; }
+	
+	bool is_repeated(size_t idx) const
 	{
-		_idx() = new_elem ;
-		//_buffer[_idx] = new_elem;
-		_idx++;
+		idx &= _mask;
+		return (_repeated[idx >> 6] >> (idx & 63)) & 1;
 	}
 	
-	~CircularBuffer()
+	void set_degrees(size_t idx, int nb_in, int nb_out)
 	{
-		free(_buffer);
-	};
+		_nb_in[idx & _mask] = nb_in;
+		_nb_out[idx & _mask] = nb_out;
+	}
 	
-	void clear()
+	void set_repeated(size_t idx, bool is_repeated)
 	{
-		memset(_buffer,0,sizeof(elem_t)*_tai);
-		_idx = itCB(this);
+		idx &= _mask;
+		u_int64_t bit = (u_int64_t)1 << (idx & 63);
+		if(is_repeated)
+			_repeated[idx >> 6] |= bit;
+		else
+			_repeated[idx >> 6] &= ~bit;
 	}
 	
-
-	class itCB // iterator of circularbuffer
+	void set(size_t idx, const kmer_t& kmer, int nb_in, int nb_out, bool is_repeated)
 	{
-	public:
-		u_int64_t _idx;
-		CircularBuffer<elem_t> * _ref;
-		
-		itCB (CircularBuffer *ref)
-		{
-			_idx = 0;
-			_ref=ref;
-		}
-		
-		elem_t & operator()()
-		{
-			return _ref->_buffer[_idx];
-		}
-		elem_t & item()
-		{
-			return _ref->_buffer[_idx];
-		}
-		
-		void set(u_int64_t val)
-		{
-			_idx = val & _ref->_mask;
-		}
-		
-		itCB   operator+( u_int64_t rhs) //member func
-		{
-			itCB  nit =  itCB(this->_ref);
-			nit._idx =  (this->_idx + rhs) & _ref->_mask;
-			return nit;
-		}
-		itCB   operator-( u_int64_t rhs) //member func
-		{
-			itCB  nit =  itCB(this->_ref);
-			nit._idx =  (this->_idx - rhs) & _ref->_mask;
-			return nit;
-		}
-		void operator++(int) //postfix operator
-		{
-			_idx = (_idx+1) & _ref->_mask;
-		}
-		void operator--(int)
-		{
-			_idx = (_idx-1) & _ref->_mask;
-		}
-	};
+		_kmers[idx & _mask] = kmer;
+		set_degrees(idx, nb_in, nb_out);
+		set_repeated(idx, is_repeated);
+	}
 	
 private:
 	
-	elem_t * _buffer;
-	u_int64_t _tai;
-	u_int64_t _mask;
-	itCB _idx; //index to next free cell
+	size_t _tai;
+	size_t _mask;
+	std::vector<kmer_t> _kmers;
+	std::vector<unsigned char> _nb_in; // degrees are at most 4
+	std::vector<unsigned char> _nb_out;
+	std::vector<u_int64_t> _repeated; // one bit per kmer
 	
 };
 
@@ -128,4 +102,3 @@ private:
 
 
 #endif /* CircularBuffer_hpp */
-
@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _ExtensionCache_HPP_
+#define _ExtensionCache_HPP_
+
+#include <gatb/gatb_core.hpp>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+
+/**
+ * Contigs built by the extension from a source sequence towards a target sequence (IterativeExtensions::construct_linear_seqs), shared by the fill threads :
+ * several breakpoints often have the same left and right kmers (HOM and HET calls at one site), and their gap-fillings can then skip the extension.
+ * The extension stops when the target is found, so the entries are keyed by the source and the target sequences.
+ * The other parameters of the extension are not in the key : the direction is in the source sequence (the reverse gap-filling starts from
+ * the reverse complement of the target), and max-depth and max-nodes are the same for all the gap-fillings of a Filler.
+ * The cache is split in shards, each one with its own lock and its own part of the maximal size : when full, its least recently used entries are removed.
+ */
+class ExtensionCache
+{
+public:
+
+    typedef std::shared_ptr<const std::vector<std::string> > contigs_t;
+
+    /** max_size : total size of the cached contigs and of their keys (nt), 0 : nothing is cached */
+    ExtensionCache (u_int64_t max_size, size_t nb_shards = 64)
+        : _shards(nb_shards), _max_shard_size(max_size / nb_shards), _nb_hits(0), _nb_misses(0)
+    {
+        for (size_t i = 0; i < _shards.size(); i++)  { _shards[i].synchro = System::thread().newSynchronizer(); }
+    }
+
+    ~ExtensionCache ()
+    {
+        for (size_t i = 0; i < _shards.size(); i++)  { delete _shards[i].synchro; }
+    }
+
+    /** The contigs of the extension from the source towards the target, NULL if they are not in the cache */
+    contigs_t get (const std::string& source, const std::string& target)
+    {
+        std::string key = make_key (source, target);
+        shard_t& shard = get_shard (key);
+        LocalSynchronizer local (shard.synchro);
+
+        entries_t::iterator it = shard.entries.find (key);
+        if (it == shard.entries.end())
+        {
+            __sync_fetch_and_add (&_nb_misses, 1);
+            return contigs_t();
+        }
+        __sync_fetch_and_add (&_nb_hits, 1);
+
+        // most recently used first
+        shard.lru.splice (shard.lru.begin(), shard.lru, it->second.lru_pos);
+        return it->second.contigs;
+    }
+
+    /** Adds the contigs of the extension from the source towards the target, unless they are larger than a shard */
+    void put (const std::string& source, const std::string& target, const std::vector<std::string>& contigs)
+    {
+        std::string key = make_key (source, target);
+        u_int64_t size = 2 * key.size(); // in the entries and in the lru list
+        for (size_t i = 0; i < contigs.size(); i++)  { size += contigs[i].size(); }
+        if (size > _max_shard_size)  { return; }
+
+        contigs_t copy (new std::vector<std::string> (contigs));
+
+        shard_t& shard = get_shard (key);
+        LocalSynchronizer local (shard.synchro);
+
+        // already added by another thread
+        if (shard.entries.find (key) != shard.entries.end())  { return; }
+
+        while (shard.size + size > _max_shard_size)
+        {
+            entries_t::iterator last = shard.entries.find (shard.lru.back());
+            shard.size -= last->second.size;
+            shard.entries.erase (last);
+            shard.lru.pop_back();
+        }
+
+        shard.lru.push_front (key);
+        entry_t& entry = shard.entries[key];
+        entry.contigs  = copy;
+        entry.size     = size;
+        entry.lru_pos  = shard.lru.begin();
+        shard.size += size;
+    }
+
+    u_int64_t nb_hits   () const { return _nb_hits;   }
+    u_int64_t nb_misses () const { return _nb_misses; }
+
+private:
+
+    struct entry_t
+    {
+        contigs_t contigs;
+        u_int64_t size;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    typedef std::unordered_map<std::string, entry_t> entries_t;
+
+    struct shard_t
+    {
+        shard_t () : synchro(NULL), size(0) {}
+
+        ISynchronizer* synchro;
+        entries_t entries;
+        std::list<std::string> lru; // keys, most recently used first
+        u_int64_t size;
+    };
+
+    static std::string make_key (const std::string& source, const std::string& target)  { return source + '\0' + target; }
+
+    shard_t& get_shard (const std::string& key)  { return _shards[std::hash<std::string>() (key) % _shards.size()]; }
+
+    std::vector<shard_t> _shards;
+    u_int64_t _max_shard_size;
+    u_int64_t _nb_hits;
+    u_int64_t _nb_misses;
+
+    ExtensionCache (const ExtensionCache&);
+    ExtensionCache& operator= (const ExtensionCache&);
+};
+
+#endif /* _ExtensionCache_HPP_ */
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _FillContext_HPP_
+#define _FillContext_HPP_
+
+#include <gatb/gatb_core.hpp>
+#include <Filler.hpp>
+#include <GraphAnalysis.hpp>
+#include <LinearSeqsBank.hpp>
+#include <GraphOutputMemory.hpp>
+#include <ExtensionCache.hpp>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * What a fill worker thread needs for its gap-fillings (see Filler::gapFillFromSource) : the extension engine on the de Bruijn graph,
+ * the contig graph and its analysis. They are built once per thread and only reset between two gap-fillings,
+ * so that their tables and buffers are not allocated and initialized again for each gap.
+ */
+template<size_t span>
+class FillContext
+{
+public:
+
+    typedef typename gatb::core::kmer::impl::Kmer<span>::ModelCanonical ModelCanonical;
+    typedef typename gatb::core::kmer::impl::Kmer<span>::Type Type;
+
+    struct TypeHash  {  size_t operator() (const Type& kmer) const  { return oahash(kmer); }  };
+
+    FillContext (const Graph& graph, size_t kmerSize, int max_depth, int max_nodes)
+        : terminator (graph),
+          extension (graph, terminator, TRAVERSAL_CONTIG, ExtendStopMode_until_max_depth, SearchMode_Breadth, false, max_depth, max_nodes),
+          linear_seqs_bank (new LinearSeqsBank()),
+          linear_seqs (NULL),
+          graph_output (kmerSize, contig_graph),
+          model (kmerSize),
+          nb_targets_found (0),
+          reach_budget (std::max (4*max_depth, 1000))
+    {
+        //todo check param dontOutputFirstNucl=false ??
+        linear_seqs_bank->use();
+    }
+
+    ~FillContext ()  { linear_seqs_bank->forget(); }
+
+    //object used to mark the traversed nodes of the graph (note : it is reset at the beginning of construct_linear_seq)
+    BranchingTerminator terminator;
+    IterativeExtensions<span> extension;
+
+    // the contigs built by extension, and the graph connecting them, kept in memory
+    LinearSeqsBank* linear_seqs_bank;
+    // the contigs of the last gap-filling : the ones of linear_seqs_bank or of the extension cache (then also kept alive here)
+    const std::vector<std::string>* linear_seqs;
+    ExtensionCache::contigs_t cached_linear_seqs;
+    contig_graph_t contig_graph;
+    GraphOutputMemory<span> graph_output;
+
+    // analysis of the contig graph, to find the paths between the source and the targets
+    GraphAnalysis graph_analysis;
+
+    ModelCanonical model;
+
+    // number of contigs containing a target in the last gap-filling, and the kmers of its contigs (see Filler::isReverseFillUseless)
+    size_t nb_targets_found;
+    unordered_set<Type, TypeHash> extension_kmers;
+
+    // bidirectional search between the source and the target (see Filler::isTargetUnreachable) :
+    // for each canonical kmer reached, one bit per side (0 : from the source, 1 : from the target) and per strand
+    unordered_map<Type, unsigned char, TypeHash> reach_marks;
+    std::vector<Node> frontiers[2];
+    std::vector<Node> next_frontier;
+    int reach_budget; // maximal number of kmers reached from each side
+
+private:
+
+    FillContext (const FillContext&);
+    FillContext& operator= (const FillContext&);
+};
+
+#endif /* _FillContext_HPP_ */
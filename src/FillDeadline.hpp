@@ -0,0 +1,64 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _FillDeadline_HPP_
+#define _FillDeadline_HPP_
+
+#include <gatb/gatb_core.hpp>
+#include <chrono>
+
+/**
+ * Thrown by the steps of a gap-filling when its time limit is reached
+ */
+class FillTimeoutException : public Exception
+{
+public:
+    FillTimeoutException () : Exception ("time limit of the gap-filling reached") {}
+};
+
+/**
+ * Wall-clock budget of one gap-filling (option -max-time-per-gap).
+ * It is checked cooperatively by the steps of the filling (contig extension, contig graph construction, path search),
+ * check() throws a FillTimeoutException once it is expired.
+ */
+class FillDeadline
+{
+public:
+
+    /** no limit if max_seconds <= 0 */
+    FillDeadline (double max_seconds) : _limited(max_seconds > 0)
+    {
+        if (_limited)
+        {
+            _end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(max_seconds));
+        }
+    }
+
+    bool expired () const { return _limited && std::chrono::steady_clock::now() >= _end; }
+
+    void check () const { if (expired()) throw FillTimeoutException(); }
+
+private:
+
+    bool _limited;
+    std::chrono::steady_clock::time_point _end;
+};
+
+#endif /* _FillDeadline_HPP_ */
@@ -21,8 +21,11 @@
 #include <Filler.hpp>
 #include <Utils.hpp>
 #include <GraphAnalysis.hpp>
+#include <LinearSeqsBank.hpp>
+#include <FillContext.hpp>
 #include <limits> // for numeric_limits
 #include <unordered_map>
+#include <cstdarg>
 
 #define PRINT_DEBUG
 /********************************************************************************/
@@ -49,7 +52,7 @@ void HelpFiller(void* target)
 ** RETURN  :
 ** REMARKS :
 *********************************************************************/
-Filler::Filler ()  : Tool ("MindTheGap fill") , _progress(0)
+Filler::Filler ()  : Tool ("MindTheGap fill") , _progress(0), _ordered_output(0)
 {
 
     //TODO rajouter les parametres
@@ -59,11 +62,18 @@ Filler::Filler ()  : Tool ("MindTheGap fill") , _progress(0)
     _nb_breakpoints = 0;
     _nb_filled_breakpoints = 0;
     _nb_multiple_fill = 0;
+    _nb_timeouts = 0;
+    _nb_unreachable = 0;
+    _nb_reverse_skipped = 0;
+    _extension_cache = NULL;
+    _bidirectional = false;
+    _stop_at_target = false;
     _nb_contigs = 0;
     _nb_used_contigs = 0;
     _breakpointMode = true;
     _contig_trim_size = 0;
     _filter = false;
+    _dot_debug = false;
 
 
 
@@ -95,6 +105,14 @@ Filler::Filler ()  : Tool ("MindTheGap fill") , _progress(0)
     //TODO HERE PUT THE FILL OPTIONS
     fillerParser->push_front (new OptionOneParam (STR_MAX_DEPTH, "maximum length of insertions (nt)", false, "10000"));
     fillerParser->push_front (new OptionOneParam (STR_MAX_NODES, "maximum number of nodes in contig graph (nt)", false, "100"));
+    fillerParser->push_front (new OptionOneParam (STR_MAX_TIME_PER_GAP, "maximum time for one gap-filling, in seconds (0: no limit)", false, "0"));
+    fillerParser->push_front (new OptionOneParam (STR_EXTENSION_CACHE, "maximum memory of the cache of the extensions shared by the gap-fillings with the same source and target kmers, in MB (0: no cache)", false, "256"));
+    fillerParser->push_front (new OptionNoParam (STR_STOP_AT_TARGET, "stop the extension of a breakpoint gap-filling shortly after its right kmer is found, instead of exploring up to max-length", false));
+    fillerParser->push_front (new OptionNoParam (STR_BIDIRECTIONAL, "before each breakpoint gap-filling, check with a search from both kmers that the right one can be reached", false));
+
+    //Options usefull only for debugging
+    fillerParser->push_front (new OptionNoParam (STR_DOT_DEBUG, "write the contig graph of each gap-filling in a dot file", false));
+    fillerParser->getParser(STR_DOT_DEBUG)->setVisible(false);
 
     IOptionsParser* graphParser = new OptionsParser("Graph building");
     string abundanceMax = Stringify::format("%ld", std::numeric_limits<CountNumber>::max()); //to be sure in case CountNumber definition changes
@@ -282,6 +300,7 @@ void Filler::execute ()
     _nbCores = getInput()->getInt(STR_NB_CORES);
     _max_depth = getInput()->getInt(STR_MAX_DEPTH);
     _max_nodes = getInput()->getInt(STR_MAX_NODES);
+    _max_time_per_gap = getInput()->getDouble(STR_MAX_TIME_PER_GAP);
     
     _contig_trim_size = getInput()->getInt(STR_CONTIG_OVERLAP);
     //making sure overlap >=kmerSize (to have >=kmerSize overlaps in gfa edges)
@@ -293,11 +312,31 @@ void Filler::execute ()
         cerr << "Warning :  the contig overlap parameter should be greater or equal to kmer size, setting it to " << _kmerSize << endl;
     }
 
+    if(getInput()->get(STR_DOT_DEBUG) != 0)
+    {
+        _dot_debug = true;
+    }
+
+    if(getInput()->get(STR_BIDIRECTIONAL) != 0)
+    {
+        _bidirectional = true;
+    }
+
+    if(getInput()->get(STR_STOP_AT_TARGET) != 0)
+    {
+        _stop_at_target = true;
+    }
+
     if(getInput()->get(STR_FILTER) != 0)
     {
         _filter = true;
     }
     
+    if (getInput()->getInt(STR_EXTENSION_CACHE) > 0)
+    {
+        _extension_cache = new ExtensionCache((u_int64_t)getInput()->getInt(STR_EXTENSION_CACHE) * 1024 * 1024);
+    }
+
     // Now do the job
     time_t start_time = time(0);
 
@@ -322,6 +361,9 @@ void Filler::execute ()
 
     double seconds=difftime(end_time,start_time);
     resumeResults(seconds);
+
+    delete _extension_cache;
+    _extension_cache = NULL;
 }
 
 void Filler::writeVcfHeader(){
@@ -411,6 +453,18 @@ void Filler::resumeParameters(){
     getInfo()->add(1,"Assembly options");
     getInfo()->add(2,"max_depth","%i", _max_depth);
     getInfo()->add(2,"max_nodes","%i", _max_nodes);
+    if (_max_time_per_gap > 0)
+    {
+        getInfo()->add(2,"max_time_per_gap","%.1f s", _max_time_per_gap);
+    }
+    if (_bidirectional)
+    {
+        getInfo()->add(2,"bidirectional","%s", "yes");
+    }
+    if (_stop_at_target)
+    {
+        getInfo()->add(2,"stop_at_target","%s", "yes");
+    }
     if (!_breakpointMode)
     {
         getInfo()->add(2,"contig trim size before gap-filling","%i", _contig_trim_size);
@@ -437,6 +491,22 @@ void Filler::resumeResults(double seconds){
     }
         getInfo()->add(3,"as_unique_sequence","%i", _nb_filled_breakpoints-_nb_multiple_fill);
         getInfo()->add(3,"as_multiple_sequence","%i", _nb_multiple_fill);
+    if (_max_time_per_gap > 0)
+    {
+        getInfo()->add(2,"nb_stopped_by_time_limit","%i", _nb_timeouts);
+    }
+    if (_bidirectional)
+    {
+        getInfo()->add(2,"nb_unreachable","%i", _nb_unreachable);
+    }
+    if (_breakpointMode)
+    {
+        getInfo()->add(2,"nb_reverse_skipped","%i", _nb_reverse_skipped);
+    }
+    if (_extension_cache)
+    {
+        getInfo()->add(2,"nb_extensions_from_cache","%llu", (unsigned long long) _extension_cache->nb_hits());
+    }
         
     getInfo()->add(1,"Time", "%.1f s",seconds);
     getInfo()->add(1,"Output files");
@@ -455,6 +525,38 @@ void Filler::resumeResults(double seconds){
 }
 
 
+/* One gap-filling : a seed in contig mode, the source and target kmers of a breakpoint in breakpoint mode.
+ * The items are dispatched to the threads one at a time, most expensive first (see fillAny).
+ */
+struct fill_item_t
+{
+    string source_sequence;
+    string source_name;
+    string target_sequence; // breakpoint mode only
+    string target_name;
+    bool is_anchor_repeated;
+    int cost;
+    size_t index; // rank in the input : the outputs are written in this order
+};
+
+static bool compare_fill_cost(const fill_item_t& a, const fill_item_t& b)
+{
+    return a.cost > b.cost;
+}
+
+// Cheap estimate of the cost of a gap-filling : repeated anchors and branching source kmers lead to the largest contig graphs
+static int estimate_fill_cost(const Graph& graph, size_t kmerSize, const string& sourceSequence, bool is_anchor_repeated)
+{
+    int cost = is_anchor_repeated ? 16 : 0;
+    if (sourceSequence.size() >= kmerSize)
+    {
+        Node node = graph.buildNode(sourceSequence.c_str(), sourceSequence.size() - kmerSize);
+        cost += graph.indegree(node) + graph.outdegree(node);
+    }
+    return cost;
+}
+
+
 template<size_t span>
 class contigFunctor
 {
@@ -463,12 +565,13 @@ class contigFunctor
     typedef typename Kmer<span>::Type  Type;
 
 public:
-    void operator() (Sequence& sequence)
+    void operator() (u_int64_t rank)
     {
+    const fill_item_t& item = (*_items)[rank];
 
-    string sourceSequence = string(sequence.getDataBuffer(),sequence.getDataSize());
+    string sourceSequence = item.source_sequence;
 
-    string seedName = sequence.getComment();
+    string seedName = item.source_name;
     string seedNameRc;
     string infostring;
     bool isRc;
@@ -490,24 +593,17 @@ public:
     bool is_anchor_repeated = false;
     bool reverse = false;
 
-    string conc_targetSequence;
-    bkpt_dict_t targetDictionary;
-
-    for (auto its=_all_targetDictionary.begin(); its !=_all_targetDictionary.end(); ++its)
-    {
-        string& targetName= its->second.first;
-        string tempName = targetName;
-        if(its->second.second) tempName += "_Rc";
-
-        if (tempName.compare(seedName) != 0) // Avoid solutions Looping on the same contig
-        {
-            conc_targetSequence.append(its->first);
-            targetDictionary.insert({its->first,its->second});
-        } 
-     }
-        
+    // the targets of the seed contig itself are ignored (avoid solutions looping on the same contig)
     std::vector<filled_insertion_t> filledSequences;
-     _object->gapFillFromSource<span>(infostring,_tid, sourceSequence, conc_targetSequence,filledSequences, targetDictionary, is_anchor_repeated, reverse );
+    FillDeadline deadline (_object->_max_time_per_gap);
+    try
+    {
+        _object->gapFillFromSource<span>(infostring,context(), sourceSequence, *_all_targetSequence,filledSequences, *_targetIndex, &seedName, is_anchor_repeated, reverse, deadline );
+    }
+    catch (FillTimeoutException& e)
+    {
+        _object->timeoutGapFill(infostring, filledSequences);
+    }
 
     // We filter out loops (ie target = seed_Rc)
     for (auto it=filledSequences.begin() ; it != filledSequences.end();)
@@ -529,9 +625,11 @@ public:
         }
     }
 
-     // Write insertions to file
-     _object->writeFilledBreakpoint(filledSequences,seedName,infostring);
-     _object->writeToGFA(filledSequences,sourceSequence,seedName,isRc);
+     // Write insertions to file, in the order of the seeds
+     fill_output_t output;
+     _object->writeFilledBreakpoint(filledSequences,seedName,infostring,output);
+     _object->writeToGFA(filledSequences,sourceSequence,seedName,isRc,output);
+     _object->_ordered_output->submit(item.index, output);
         
 
      _nb_breakpoints++;
@@ -543,7 +641,7 @@ public:
 
 
     //constructor
-    contigFunctor(Filler* object, int * nb_living, int * global_nb_breakpoints, bkpt_dict_t all_targetDictionary) : _object(object),_global_nb_breakpoints(global_nb_breakpoints),_all_targetDictionary(all_targetDictionary)
+    contigFunctor(Filler* object, int * nb_living, int * global_nb_breakpoints, const vector<fill_item_t>* items, const AnchorIndex* targetIndex, const string* all_targetSequence) : _object(object),_global_nb_breakpoints(global_nb_breakpoints),_items(items),_targetIndex(targetIndex),_all_targetSequence(all_targetSequence),_context(NULL)
     {
         _nb_living =nb_living;
         _tid =  __sync_fetch_and_add (_nb_living, 1);
@@ -554,7 +652,10 @@ public:
 
     contigFunctor(contigFunctor const &r)
     {
-        _all_targetDictionary = r._all_targetDictionary;
+        _items = r._items;
+        _targetIndex = r._targetIndex;
+        _all_targetSequence = r._all_targetSequence;
+        _context = NULL;
         _nb_living = r._nb_living;
         _object= r._object;
         _global_nb_breakpoints = r._global_nb_breakpoints;
@@ -568,17 +669,31 @@ public:
     ~contigFunctor()
     {
          __sync_fetch_and_add (_global_nb_breakpoints, _nb_breakpoints);
+         delete _context;
     }
 private:
+
+    // the engines of this thread, built at its first gap-filling (the copies of the functor do not share them)
+    FillContext<span>& context()
+    {
+        if (_context == NULL)  { _context = new FillContext<span> (_object->_graph, _object->_kmerSize, _object->_max_depth, _object->_max_nodes); }
+        return *_context;
+    }
+
     Filler* _object;
     int _tid;
     int _nb_breakpoints;
     int * _global_nb_breakpoints;
     int * _nb_living;
 
-    Sequence _previousSeq;
     u_int64_t _nbBreakpointsProgressDone = 0;
-    bkpt_dict_t _all_targetDictionary;
+
+    // shared by all the threads, built once in fillAny
+    const vector<fill_item_t>* _items;
+    const AnchorIndex* _targetIndex;
+    const string* _all_targetSequence;
+
+    FillContext<span>* _context;
 };
 
 
@@ -590,29 +705,20 @@ class breakpointFunctor
     typedef typename Kmer<span>::Type  Type;
 
 public:
-    void operator() (Sequence& sequence)
+    void operator() (u_int64_t rank)
     {
-        if( (sequence.getIndex() & 1) == 0)
+        const fill_item_t& item = (*_items)[rank];
         {
-            _previousSeq = sequence; //first sequence (source) of the breakpoint
-        }
-        else //second sequence (target) of the breakpoint
-        {
-            
-            string sourceSequence =  string(_previousSeq.getDataBuffer(),_previousSeq.getDataSize());//previously L
+            string sourceSequence = item.source_sequence;//previously L
 
-            string breakpointName = string(_previousSeq.getCommentShort());
+            string breakpointName = item.source_name;
 
             string infostring; //to store some statitistics about the gap-filling process
 
-            bool begin_kmer_repeated = _previousSeq.getComment().find("REPEATED") !=  std::string::npos;
-
+            string targetSequence = item.target_sequence;//previously R
 
-            string targetSequence =  string(sequence.getDataBuffer(),sequence.getDataSize());//previously R
-
-            string breakpointName_R = string(sequence.getCommentShort());
-            bool end_kmer_repeated = sequence.getComment().find("REPEATED") !=  std::string::npos;
-            bool is_anchor_repeated = begin_kmer_repeated || end_kmer_repeated;
+            string breakpointName_R = item.target_name;
+            bool is_anchor_repeated = item.is_anchor_repeated;
 
             //printf("nb_mis_allowed %i \n",nb_mis_allowed);
 
@@ -628,26 +734,47 @@ public:
                 targetSequence.substr(0,_object->_kmerSize); //prefix of size _kmerSize
             }
             targetDictionary.insert ({targetSequence, std::make_pair(breakpointName_R, false)});
+            AnchorIndex targetIndex (targetDictionary, _object->_kmerSize, _object->_nb_mis_allowed);
 
-            //_object->gapFill<span>(infostring,_tid,sourceSequence,targetSequence,filledSequences,begin_kmer_repeated,end_kmer_repeated);
-            _object->gapFillFromSource<span>(infostring,_tid, sourceSequence, targetSequence,filledSequences, targetDictionary, is_anchor_repeated, false);
+            FillDeadline deadline (_object->_max_time_per_gap);
+            if (_object->_bidirectional && _object->isTargetUnreachable<span>(context(), sourceSequence, targetSequence, is_anchor_repeated))
+            {
+                _object->unreachableGapFill(infostring);
+            }
+            else try
+            {
+                //_object->gapFill<span>(infostring,_tid,sourceSequence,targetSequence,filledSequences,begin_kmer_repeated,end_kmer_repeated);
+                _object->gapFillFromSource<span>(infostring,context(), sourceSequence, targetSequence,filledSequences, targetIndex, NULL, is_anchor_repeated, false, deadline);
 
-            //If gap-filling failed in one direction, try the other direction (from target to source in revcomp)
-            if(filledSequences.size()==0){
-                string targetSequence2 = revcomp_sequence(sourceSequence);
-                targetDictionary.clear();
-                targetDictionary.insert({targetSequence2, std::make_pair(breakpointName, false)});
-                string sourceSequence2 = revcomp_sequence(targetSequence);
-                breakpointName= breakpointName_R;
+                //If gap-filling failed in one direction, try the other direction (from target to source in revcomp),
+                //unless the contigs of the first direction already show that there is no path
+                if(filledSequences.size()==0 && _object->isReverseFillUseless<span>(context(), sourceSequence, is_anchor_repeated)){
+                    __sync_fetch_and_add(& _object->_nb_reverse_skipped,1);
+                }
+                else if(filledSequences.size()==0){
+                    string targetSequence2 = revcomp_sequence(sourceSequence);
+                    targetDictionary.clear();
+                    targetDictionary.insert({targetSequence2, std::make_pair(breakpointName, false)});
+                    AnchorIndex targetIndex2 (targetDictionary, _object->_kmerSize, _object->_nb_mis_allowed);
+                    string sourceSequence2 = revcomp_sequence(targetSequence);
+                    breakpointName= breakpointName_R;
 
 
-                //_object->GapFill<span>(infostring,_tid,sourceSequence2,targetSequence2,filledSequences,begin_kmer_repeated,end_kmer_repeated,true);
-                _object->gapFillFromSource<span>(infostring,_tid, sourceSequence2, targetSequence2,filledSequences, targetDictionary, is_anchor_repeated, true);
+                    //_object->GapFill<span>(infostring,_tid,sourceSequence2,targetSequence2,filledSequences,begin_kmer_repeated,end_kmer_repeated,true);
+                    _object->gapFillFromSource<span>(infostring,context(), sourceSequence2, targetSequence2,filledSequences, targetIndex2, NULL, is_anchor_repeated, true, deadline);
 
+                }
+            }
+            catch (FillTimeoutException& e)
+            {
+                _object->timeoutGapFill(infostring, filledSequences);
             }
 
-            _object->writeFilledBreakpoint(filledSequences,breakpointName,infostring);
-            _object->writeVcf(filledSequences,breakpointName,sourceSequence);
+            // in the order of the breakpoints
+            fill_output_t output;
+            _object->writeFilledBreakpoint(filledSequences,breakpointName,infostring,output);
+            _object->writeVcf(filledSequences,breakpointName,sourceSequence,output);
+            _object->_ordered_output->submit(item.index, output);
 
             
             // We increase the breakpoint counter.
@@ -661,7 +788,7 @@ public:
     }
 
     //constructor
-    breakpointFunctor(Filler* object, int * nb_living, int * global_nb_breakpoints) : _object(object),_global_nb_breakpoints(global_nb_breakpoints)
+    breakpointFunctor(Filler* object, int * nb_living, int * global_nb_breakpoints, const vector<fill_item_t>* items) : _object(object),_global_nb_breakpoints(global_nb_breakpoints),_items(items),_context(NULL)
     {
         _nb_living =nb_living;
         _tid =  __sync_fetch_and_add (_nb_living, 1);
@@ -673,6 +800,8 @@ public:
 
     breakpointFunctor(breakpointFunctor const &r)
     {
+        _items = r._items;
+        _context = NULL;
         _nb_living = r._nb_living;
         _object= r._object;
         _global_nb_breakpoints = r._global_nb_breakpoints;
@@ -686,8 +815,17 @@ public:
     ~breakpointFunctor()
     {
          __sync_fetch_and_add (_global_nb_breakpoints, _nb_breakpoints);
+         delete _context;
     }
 private:
+
+    // the engines of this thread, built at its first gap-filling (the copies of the functor do not share them)
+    FillContext<span>& context()
+    {
+        if (_context == NULL)  { _context = new FillContext<span> (_object->_graph, _object->_kmerSize, _object->_max_depth, _object->_max_nodes); }
+        return *_context;
+    }
+
     Filler* _object;
 
     int _tid;
@@ -695,9 +833,12 @@ private:
     int * _global_nb_breakpoints;
     int * _nb_living;
     int _nb_mis_allowed = 2; // To fix, should be read from global parameters
-    Sequence _previousSeq;
     u_int64_t _nbBreakpointsProgressDone = 0;
 
+    // shared by all the threads, sorted in fillAny
+    const vector<fill_item_t>* _items;
+
+    FillContext<span>* _context;
 };
 
 
@@ -718,8 +859,9 @@ void Filler::fillAny<span>::operator () (Filler* object)
 
         bkpt_dict_t seedDictionary;
         bkpt_dict_t all_targetDictionary;
+        vector<fill_item_t> items;
 
-        // seed sequences will be written on disk to create a seed Bank
+        // seed sequences are also written on disk (seed dictionary file)
         // Original contigs written as nodes of the GFA file
         ofstream seedFile;
         string seedFileName = object->getInput()->getStr(STR_URI_OUTPUT)+"_seed_dictionary.fasta";
@@ -758,6 +900,11 @@ void Filler::fillAny<span>::operator () (Filler* object)
                 seedFile << ">"+string(itSeq->getCommentShort())+"_Rc\n";
                 seedFile << seedSequence_Rc << endl;
 
+                fill_item_t item_f = {seedSequence_f, name, "", "", false, 0, items.size()};
+                fill_item_t item_Rc = {seedSequence_Rc, name + "_Rc", "", "", false, 0, items.size()+1};
+                items.push_back(item_f);
+                items.push_back(item_Rc);
+
                 object->_nb_used_contigs++;
 
             }
@@ -777,13 +924,32 @@ void Filler::fillAny<span>::operator () (Filler* object)
         object->_progress->init ();
 
 
-        BankFasta inbank (seedFileName);
-        BankFasta::Iterator it (inbank);
+        // the target kmers are indexed once, the index and their concatenation are shared (read-only) by all the threads
+        AnchorIndex targetIndex (all_targetDictionary, kmerSize, object->_nb_mis_allowed);
+        string all_targetSequence;
+        all_targetSequence.reserve(all_targetDictionary.size() * kmerSize);
+        for (bkpt_dict_t::const_iterator its = all_targetDictionary.begin(); its != all_targetDictionary.end(); ++its)
+        {
+            all_targetSequence.append(its->first);
+        }
+
+        // one seed at a time, the most expensive ones first : the threads do not wait for a long batch at the end
+        for (vector<fill_item_t>::iterator it = items.begin(); it != items.end(); ++it)
+        {
+            it->cost = estimate_fill_cost(object->_graph, kmerSize, it->source_sequence, false);
+        }
+        std::stable_sort(items.begin(), items.end(), compare_fill_cost);
 
         int nb_living=0;
-        
 
-        Dispatcher(object->getInput()->getInt(STR_NB_CORES)).iterate(it, contigFunctor<span>(object,&nb_living,&object->_nb_breakpoints,all_targetDictionary),30);
+        if (!items.empty())
+        {
+            object->_ordered_output = new OrderedFillOutput(items.size(), object->_insert_file, object->_insert_info_file, NULL, object->_gfa_file);
+            Range<u_int64_t>::Iterator it (0, items.size()-1);
+            Dispatcher(object->getInput()->getInt(STR_NB_CORES)).iterate(it, contigFunctor<span>(object,&nb_living,&object->_nb_breakpoints,&items,&targetIndex,&all_targetSequence),1);
+            delete object->_ordered_output;
+            object->_ordered_output = NULL;
+        }
 
         object->_nb_breakpoints = object->_nb_breakpoints ;
         object->_progress->finish ();
@@ -801,10 +967,42 @@ void Filler::fillAny<span>::operator () (Filler* object)
         object->_progress->init ();
 
 
+        // the two sequences (source then target) of each breakpoint
+        vector<fill_item_t> items;
+        fill_item_t item;
+        for (itSeq.first(); !itSeq.isDone(); itSeq.next())
+        {
+            bool is_repeated = itSeq->getComment().find("REPEATED") != std::string::npos;
+            if ((itSeq->getIndex() & 1) == 0)
+            {
+                item.source_sequence = string(itSeq->getDataBuffer(),itSeq->getDataSize());
+                item.source_name = string(itSeq->getCommentShort());
+                item.is_anchor_repeated = is_repeated;
+            }
+            else
+            {
+                item.target_sequence = string(itSeq->getDataBuffer(),itSeq->getDataSize());
+                item.target_name = string(itSeq->getCommentShort());
+                item.is_anchor_repeated = item.is_anchor_repeated || is_repeated;
+                item.cost = estimate_fill_cost(object->_graph, object->_kmerSize, item.source_sequence, item.is_anchor_repeated);
+                item.index = items.size();
+                items.push_back(item);
+            }
+        }
+
+        // one breakpoint at a time, the most expensive ones first : the threads do not wait for a long batch at the end
+        std::stable_sort(items.begin(), items.end(), compare_fill_cost);
+
         int nb_living=0;
 
-        Dispatcher(object->getInput()->getInt(STR_NB_CORES)).iterate(itSeq, breakpointFunctor<span>(object,&nb_living,&object->_nb_breakpoints),30);
-        //WARNING : 30 = number of sequences sent to each thread, keep it *even* (2 sequences for one breakpoint)
+        if (!items.empty())
+        {
+            object->_ordered_output = new OrderedFillOutput(items.size(), object->_insert_file, object->_insert_info_file, object->_vcf_file, NULL);
+            Range<u_int64_t>::Iterator it (0, items.size()-1);
+            Dispatcher(object->getInput()->getInt(STR_NB_CORES)).iterate(it, breakpointFunctor<span>(object,&nb_living,&object->_nb_breakpoints,&items),1);
+            delete object->_ordered_output;
+            object->_ordered_output = NULL;
+        }
 
         object->_nb_breakpoints = object->_nb_breakpoints ;
         object->_progress->finish ();
@@ -813,9 +1011,186 @@ void Filler::fillAny<span>::operator () (Filler* object)
     }
 }
 
+// marks the node as reached by the search from this side (0 : from the source, 1 : from the target),
+// returns -1 if it was already reached from the other side (the two searches meet), 0 if it was already reached from this side, 1 otherwise
+template<typename Type, typename Marks>
+static int mark_reached(Marks& reach_marks, const Node& node, int side)
+{
+    unsigned char strand_bit = (node.strand == STRAND_FORWARD) ? 1 : 2;
+    unsigned char& mark = reach_marks[node.kmer.get<Type>()];
+    if (mark & (strand_bit << (2*(1-side))))  { return -1; }
+    if (mark & (strand_bit << (2*side)))      { return 0; }
+    mark |= strand_bit << (2*side);
+    return 1;
+}
+
+// calls f(node, kmer) for each solid kmer with 1 to nb_mis substitutions after position start of the anchor (modified during the enumeration),
+// stops and returns false as soon as f returns false
+template<typename Functor>
+static bool for_each_substituted_kmer(const Graph& graph, string& anchor, size_t start, int nb_mis, Functor& f)
+{
+    static const char nucleotides[4] = {'A','C','G','T'};
+
+    for (size_t i = start; i < anchor.size(); i++)
+    {
+        char original = anchor[i];
+        for (int nt = 0; nt < 4; nt++)
+        {
+            if (nucleotides[nt] == original)  { continue; }
+            anchor[i] = nucleotides[nt];
+
+            Node node = graph.buildNode(anchor.c_str());
+            bool go_on = (!graph.contains(node) || f(node, anchor))
+                      && (nb_mis <= 1 || for_each_substituted_kmer(graph, anchor, i+1, nb_mis-1, f));
+            if (!go_on)
+            {
+                anchor[i] = original;
+                return false;
+            }
+        }
+        anchor[i] = original;
+    }
+    return true;
+}
+
+// adds the kmers to the frontier of the side, returns false if the two searches meet
+template<size_t span>
+struct add_to_frontier_t
+{
+    typedef typename Kmer<span>::Type Type;
+
+    FillContext<span>& context;
+    int side;
+
+    bool operator() (const Node& node, const string& kmer)
+    {
+        int reached = mark_reached<Type>(context.reach_marks, node, side);
+        if (reached > 0)  { context.frontiers[side].push_back(node); }
+        return reached >= 0;
+    }
+};
+
+// checks that the kmer, in this direction, is in the contigs of the last extension
+template<size_t span>
+struct in_extension_t
+{
+    FillContext<span>& context;
+
+    bool operator() (const Node& node, const string& kmer)
+    {
+        return context.extension_kmers.find(context.model.codeSeed(kmer.c_str(), Data::ASCII).forward()) != context.extension_kmers.end();
+    }
+};
+
+template<size_t span>
+bool Filler::isReverseFillUseless(FillContext<span>& context, const string& sourceSequence, bool is_anchor_repeated)
+{
+    typedef typename Kmer<span>::ModelCanonical ModelCanonical;
+    const std::vector<std::string>& linear_seqs = *context.linear_seqs;
+
+    // a target was found (but no path), or the extension was stopped by max-nodes
+    if (context.nb_targets_found > 0 || linear_seqs.size() >= (size_t)_max_nodes)  { return false; }
+    if (sourceSequence.size() != _kmerSize || sourceSequence.find_first_not_of("ACGT") != string::npos)  { return false; }
+
+    // the kmers of the contigs, in the direction of the extension
+    context.extension_kmers.clear();
+    typename ModelCanonical::Iterator itk (context.model);
+    for (size_t i = 0; i < linear_seqs.size(); i++)
+    {
+        Data data ((char*)linear_seqs[i].c_str());
+        itk.setData (data);
+        for (itk.first(); !itk.isDone(); itk.next())
+        {
+            context.extension_kmers.insert(itk->forward());
+        }
+    }
+
+    // the extension went as far as possible if the successors of the source and of the last kmer of each contig are all in the contigs
+    in_extension_t<span> in_extension = {context};
+    for (size_t i = 0; i <= linear_seqs.size(); i++)
+    {
+        const string& seq = (i < linear_seqs.size()) ? linear_seqs[i] : sourceSequence;
+        if (seq.size() < _kmerSize)  { return false; }
+
+        string successor = seq.substr(seq.size() - _kmerSize + 1) + 'A';
+        for (int nt = 0; nt < 4; nt++)
+        {
+            successor[_kmerSize-1] = "ACGT"[nt];
+            Node node = _graph.buildNode(successor.c_str());
+            if (_graph.contains(node) && !in_extension(node, successor))  { return false; }
+        }
+    }
+
+    // the reverse gap-filling looks for the source with mismatches : its solid variants must have been reached by the extension too
+    int nb_mis_allowed = is_anchor_repeated ? 0 : _nb_mis_allowed;
+    string anchor = sourceSequence;
+    return nb_mis_allowed == 0 || for_each_substituted_kmer(_graph, anchor, 0, nb_mis_allowed, in_extension);
+}
+
+template<size_t span>
+bool Filler::isTargetUnreachable(FillContext<span>& context, const string& sourceSequence, const string& targetSequence, bool is_anchor_repeated)
+{
+    typedef typename Kmer<span>::Type Type;
+
+    // only anchors of one kmer without gaps are handled, the gap-filling is done for the other ones
+    if (_nb_gap_allowed > 0 || sourceSequence.size() != _kmerSize || targetSequence.size() != _kmerSize)  { return false; }
+    if (sourceSequence.find_first_not_of("ACGT") != string::npos || targetSequence.find_first_not_of("ACGT") != string::npos)  { return false; }
+
+    // the target is matched with the same number of mismatches as in gapFillFromSource, and so is the source by the reverse gap-filling
+    int nb_mis_allowed = is_anchor_repeated ? 0 : _nb_mis_allowed;
+    int nb_mis = 0;
+    for (size_t i = 0; i < _kmerSize; i++)
+    {
+        if (sourceSequence[i] != targetSequence[i])  { nb_mis++; }
+    }
+    if (nb_mis <= nb_mis_allowed)  { return false; }
+
+    // the search starts from the anchor (even if it is not solid) and its solid variants, forward from the source and backward from the target
+    context.reach_marks.clear();
+    string anchors[2] = {sourceSequence, targetSequence};
+    for (int side = 0; side < 2; side++)
+    {
+        context.frontiers[side].clear();
+        Node node = _graph.buildNode(anchors[side].c_str());
+        if (mark_reached<Type>(context.reach_marks, node, side) < 0)  { return false; }
+        context.frontiers[side].push_back(node);
+
+        add_to_frontier_t<span> add_to_frontier = {context, side};
+        if (nb_mis_allowed > 0 && !for_each_substituted_kmer(_graph, anchors[side], 0, nb_mis_allowed, add_to_frontier))  { return false; }
+    }
+
+    // extends the smallest frontier by one nucleotide, until the two searches meet or one of them has reached all it can
+    size_t nb_reached[2] = {context.frontiers[0].size(), context.frontiers[1].size()};
+    while (!context.frontiers[0].empty() && !context.frontiers[1].empty())
+    {
+        int side = (context.frontiers[0].size() <= context.frontiers[1].size()) ? 0 : 1;
+        std::vector<Node>& frontier = context.frontiers[side];
+        context.next_frontier.clear();
+
+        for (size_t i = 0; i < frontier.size(); i++)
+        {
+            GraphVector<Node> neighbors = (side == 0) ? _graph.successors(frontier[i]) : _graph.predecessors(frontier[i]);
+            for (size_t j = 0; j < neighbors.size(); j++)
+            {
+                int reached = mark_reached<Type>(context.reach_marks, neighbors[j], side);
+                if (reached < 0)  { return false; }
+                if (reached > 0)
+                {
+                    context.next_frontier.push_back(neighbors[j]);
+                    // too large to be searched entirely : the gap-filling will decide
+                    if (++nb_reached[side] > (size_t)context.reach_budget)  { return false; }
+                }
+            }
+        }
+        frontier.swap(context.next_frontier);
+    }
+    return true;
+}
+
 template<size_t span>
-void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceSequence, string targetSequence, std::vector<filled_insertion_t>& filledSequences, bkpt_dict_t targetDictionary, bool is_anchor_repeated, bool reverse ){
+void Filler::gapFillFromSource(std::string & infostring, FillContext<span>& context, const string& sourceSequence, const string& targetSequence, std::vector<filled_insertion_t>& filledSequences, const AnchorIndex& targetIndex, const string* excluded_target, bool is_anchor_repeated, bool reverse, const FillDeadline& deadline ){
     typedef typename gatb::core::kmer::impl::Kmer<span>::ModelCanonical ModelCanonical;
+    ModelCanonical& model = context.model;
 
 
     int nb_mis_allowed = _nb_mis_allowed;
@@ -824,34 +1199,71 @@ void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceS
         nb_mis_allowed=0;
     }
     
-    //object used to mark the traversed nodes of the graph (note : it is reset at the beginning of construct_linear_seq)
-    BranchingTerminator terminator (_graph);
-    IterativeExtensions<span> extension (_graph, terminator, TRAVERSAL_CONTIG, ExtendStopMode_until_max_depth, SearchMode_Breadth, false, _max_depth, _max_nodes);
-    //todo check param dontOutputFirstNucl=false ??
-    //todo put these two above lines in fillBreakpoints and pass object extension in param
-
-    //prepare temporary file names
-    string rev_str=""; //used to have distinct contig file names for forward and reverse extension (usefull if investigating one breakpoint and code lines with remove command are commented)
-    if (reverse){
-        rev_str="_rev";
-    }
-
-    string file_name_suffix=rev_str+ Stringify::format("%i",getpid()) + "_t" + Stringify::format("%i",tid); //to have unique file names when breakpoints are treated in parallel
-    string contig_file_name = "contigs.fasta" + file_name_suffix;
-    string contig_graph_file_prefix="contig_graph" + file_name_suffix;
-    //std::cout << contig_file_name << std::endl;
-    //std::cout << contig_graph_file_prefix << std::endl;
-
-    //Build contigs and output them in a file in fasta format
-    extension.construct_linear_seqs(sourceSequence,targetSequence,contig_file_name,true); //last param : swf will be true
-
-    // connect the contigs into a graph and write the resulting graph in a temporary file
-    GraphOutputDot<span> graph_output(_kmerSize,contig_graph_file_prefix);
-    graph_output.load_nodes_extremities(contig_file_name,infostring);
-    graph_output.first_id_els = graph_output.construct_graph(contig_file_name,"LEFT");
+    //Build contigs and keep them in memory (the terminator of the extension is reset at the beginning of construct_linear_seq),
+    //unless the extension from the same source sequence towards the same target sequence is in the cache
+    deadline.check();
+    bool stop_at_target = _stop_at_target && _breakpointMode;
+    context.cached_linear_seqs.reset();
+    if (_extension_cache && !stop_at_target)
+    {
+        context.cached_linear_seqs = _extension_cache->get(sourceSequence, targetSequence);
+    }
+
+    if (context.cached_linear_seqs)
+    {
+        context.linear_seqs = context.cached_linear_seqs.get();
+    }
+    else
+    {
+        LinearSeqsBank* linear_seqs_bank = context.linear_seqs_bank;
+        linear_seqs_bank->reset(&deadline);
+        if (stop_at_target)
+        {
+            // no need to go further than the contigs of about the same depth as the first one containing the target (the paths search keeps at most max_breadth paths)
+            linear_seqs_bank->watch_target(&targetIndex, nb_mis_allowed, excluded_target, GraphAnalysis::max_breadth);
+        }
+        try
+        {
+            context.extension.construct_linear_seqs(sourceSequence,targetSequence,linear_seqs_bank,true); //last param : swf will be true
+        }
+        catch (FillTargetReachedException& e)
+        {
+            // the contigs built so far are the contig graph
+        }
+        context.linear_seqs = &linear_seqs_bank->sequences();
+
+        // an extension stopped at its target depends on the target, it is not cached
+        if (_extension_cache && !stop_at_target)
+        {
+            _extension_cache->put(sourceSequence, targetSequence, linear_seqs_bank->sequences());
+        }
+    }
+    const std::vector<std::string>& linear_seqs = *context.linear_seqs;
+
+    // connect the contigs into a graph, also kept in memory
+    contig_graph_t& contig_graph = context.contig_graph;
+    GraphOutputMemory<span>& graph_output = context.graph_output;
+    graph_output.clear();
+    graph_output.load_nodes_extremities(linear_seqs,infostring);
+    graph_output.first_id_els = graph_output.construct_graph(linear_seqs,"LEFT",&deadline);
     graph_output.close();
 
-    set< info_node_t > terminal_nodes_with_endpos = find_nodes_containing_multiple_R(targetDictionary, contig_file_name, nb_mis_allowed, _nb_gap_allowed);
+    if (_dot_debug)
+    {
+        // the same graph in a dot file, one per source sequence and direction
+        string rev_str="";
+        if (reverse){
+            rev_str="_rev";
+        }
+        string dot_infostring;
+        GraphOutputDot<span> dot_output(_kmerSize,"contig_graph_" + sourceSequence + rev_str);
+        dot_output.load_nodes_extremities(linear_seqs,dot_infostring);
+        dot_output.first_id_els = dot_output.construct_graph(linear_seqs,"LEFT");
+        dot_output.close();
+    }
+
+    // look for the target kmers with mismatches in the contigs
+    set< info_node_t > terminal_nodes_with_endpos = find_nodes_containing_multiple_R(targetIndex, excluded_target, linear_seqs, nb_mis_allowed, _nb_gap_allowed);
     // printf("nb contig with target %zu \n",terminal_nodes_with_endpos.size());
 
     //cout << "terminal nodes = "<< endl;
@@ -865,11 +1277,13 @@ void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceS
 
     
     infostring +=   Stringify::format ("\t%d", terminal_nodes.size()) ;
+    context.nb_targets_found = terminal_nodes.size();
     if(terminal_nodes.size()>0)
      {
     
     // analyze the graph to find a satisfying gap sequence between L and R
-    GraphAnalysis graph = GraphAnalysis(graph_output.get_dot_file_name(),_kmerSize);
+    GraphAnalysis& graph = context.graph_analysis;
+    graph.load(contig_graph,_kmerSize);
     graph.debug = true;
 
 
@@ -879,7 +1293,7 @@ void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceS
     //set<pair<unlabeled_path,bkpt_t>> paths = graph.find_all_paths(terminal_nodes_with_endpos, success);
          
     //Find all paths between L and R, but starting from R towards L  (much more faster and efficient)
-    set<pair<unlabeled_path,bkpt_t>> paths = graph.find_all_paths_rev(terminal_nodes_with_endpos);
+    set<pair<unlabeled_path,bkpt_t>> paths = graph.find_all_paths_rev(terminal_nodes_with_endpos, &deadline);
 
 
     // We build a map to sort paths leading to the same target
@@ -918,7 +1332,6 @@ void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceS
         //Here add information for each filled insertion : coverage, quality, revcomp if reverse
         
         /////////compute coverage of filled sequences // make sure to compute before reverse !!!
-        ModelCanonical model (_kmerSize);
         int solution_rank = 1;
         for (std::vector<filled_insertion_t>::iterator it = tmpSequences.begin(); it != tmpSequences.end() ; ++it)
         {
@@ -977,16 +1390,44 @@ void Filler::gapFillFromSource(std::string & infostring, int tid, string sourceS
         infostring +=   Stringify::format ("\t%d", filledSequences.size()) ;
     }
      }
-    
-    remove(contig_file_name.c_str());
-    remove((contig_graph_file_prefix+".graph").c_str());
 
 }
 
 
-void Filler::writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequences,  string seedName, std::string info){
-    
-    flockfile(_insert_file);
+// a gap-filling stopped by the time limit : no sequence is output, its line of the info file ends with TIMEOUT
+void Filler::timeoutGapFill(std::string & infostring, std::vector<filled_insertion_t>& filledSequences){
+    filledSequences.clear();
+    infostring += "\tTIMEOUT";
+    __sync_fetch_and_add(& _nb_timeouts,1);
+}
+
+// a gap-filling whose target can not be reached : no search is done, its line of the info file only has UNREACHABLE
+void Filler::unreachableGapFill(std::string & infostring){
+    infostring += "\tUNREACHABLE";
+    __sync_fetch_and_add(& _nb_unreachable,1);
+}
+
+// printf-like, appended to the output of a gap-filling
+static void append_format(std::string& output, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int size = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+
+    if (size > 0)
+    {
+        size_t begin = output.size();
+        output.resize(begin + size + 1);
+        vsnprintf(&output[begin], size + 1, format, args);
+        output.resize(begin + size);
+    }
+    va_end(args);
+}
+
+void Filler::writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequences,  string seedName, std::string info, fill_output_t& output){
 
     //bool multiple_solution = false;
     
@@ -1007,7 +1448,7 @@ void Filler::writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequen
         //writing sequence header
         if(_breakpointMode) //-bkpt mode, to keep the same header name as before
         {
-            fprintf(_insert_file,">%s_len_%d_qual_%i_avg_cov_%.2f_median_cov_%.2f   %s\n",
+            append_format(output.insertions,">%s_len_%d_qual_%i_avg_cov_%.2f_median_cov_%.2f   %s\n",
                     seedName.c_str(),llen,it->qual,solu_i.c_str()
                     ,it->avg_coverage,it->median_coverage);
         }
@@ -1019,18 +1460,17 @@ void Filler::writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequen
             int cov = it->median_coverage + 0.5;
             
             string insertionName = ">"+seedName+";"+targetName+";len_"+to_string(llen)+"_qual_"+to_string(it->qual)+"_median_cov_"+to_string(cov)+"\t"+solu_i+"\n";
-            fprintf(_insert_file,"%s",insertionName.c_str());
+            output.insertions += insertionName;
         }
         
         //writing DNA sequence
-        fprintf(_insert_file,"%.*s\n",(int)llen,insertion.c_str() );
+        output.insertions.append(insertion, 0, llen);
+        output.insertions += '\n';
         
 //        if(it->solution_count >1)
 //            multiple_solution = true;
     }
 
-    funlockfile(_insert_file);
-
     if(filledSequences.size()>0)
     {
         __sync_fetch_and_add(& _nb_filled_breakpoints,1);
@@ -1043,16 +1483,10 @@ void Filler::writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequen
     
 
     //breakpoint  info file
-    flockfile(_insert_info_file);
-    
-    fprintf(_insert_info_file,"%s\t%s\n",seedName.c_str(),info.c_str());
-    
-    funlockfile(_insert_info_file);
+    output.info += seedName + "\t" + info + "\n";
 }
 
-void Filler::writeVcf(std::vector<filled_insertion_t>& filledSequences, string breakpointName, string sourceSequence){
-    
-    flockfile(_vcf_file);
+void Filler::writeVcf(std::vector<filled_insertion_t>& filledSequences, string breakpointName, string sourceSequence, fill_output_t& output){
     
     for (std::vector<filled_insertion_t>::iterator it = filledSequences.begin(); it != filledSequences.end() ; ++it)
     {
@@ -1162,16 +1596,14 @@ void Filler::writeVcf(std::vector<filled_insertion_t>& filledSequences, string b
 
         
         // write in vcf format
-        fprintf(_vcf_file,"%s\t%s\t%s\t%s\t%s\t.\t%s\tTYPE=INS;LEN=%i;QUAL=%i;NSOL=%i;NPOS=%i;AVK=%.2f;MDK=%.2f\tGT\t%s\n",chromosome.c_str(),position.c_str(),bkpt.c_str(),ref.c_str(),insertion.c_str(),filter.c_str(),size,qual,nsol,npos,it->avg_coverage,it->median_coverage,GT.c_str());
+        append_format(output.vcf,"%s\t%s\t%s\t%s\t%s\t.\t%s\tTYPE=INS;LEN=%i;QUAL=%i;NSOL=%i;NPOS=%i;AVK=%.2f;MDK=%.2f\tGT\t%s\n",chromosome.c_str(),position.c_str(),bkpt.c_str(),ref.c_str(),insertion.c_str(),filter.c_str(),size,qual,nsol,npos,it->avg_coverage,it->median_coverage,GT.c_str());
         
         
     }
     
-    funlockfile(_vcf_file);
-    
 }
 
-void Filler::writeToGFA(std::vector<filled_insertion_t>& filledSequences, string sourceSequence, string seedName, bool isRc){
+void Filler::writeToGFA(std::vector<filled_insertion_t>& filledSequences, string sourceSequence, string seedName, bool isRc, fill_output_t& output){
 
     string seedDirection = "+";
     string targetDirection;
@@ -1185,8 +1617,6 @@ void Filler::writeToGFA(std::vector<filled_insertion_t>& filledSequences, string
         seedDirection = "-";
     }
 
-    flockfile(_gfa_file);
-
     // Write gapfilling as GFA node + 2 edges
     for (std::vector<filled_insertion_t>::iterator it = filledSequences.begin(); it != filledSequences.end() ; ++it)
     {
@@ -1216,103 +1646,51 @@ void Filler::writeToGFA(std::vector<filled_insertion_t>& filledSequences, string
             // Write node
             int cov = it->median_coverage + 0.5;
             string nodeName = seedNameNode+";"+targetNameNode+";len_"+to_string(llen)+"_qual_"+to_string(qual)+"_median_cov_"+to_string(cov)+" "+solu_i; // Name could be computed once for gfa and fasta
-            fprintf(_gfa_file,"S\t%s\t%s\n",nodeName.c_str(),insertion.c_str());
+            output.gfa += "S\t" + nodeName + "\t" + insertion + "\n";
 
             // Write link between nodes
 
             // From seed to gapfilling
-            fprintf(_gfa_file,"L\t%s\t%s\t%s\t+\t%iM\n",seedName.c_str(),seedDirection.c_str(),nodeName.c_str(),_contig_trim_size);
+            append_format(output.gfa,"L\t%s\t%s\t%s\t+\t%iM\n",seedName.c_str(),seedDirection.c_str(),nodeName.c_str(),_contig_trim_size);
 
             // From gapfilling to seed
-            fprintf(_gfa_file,"L\t%s\t+\t%s\t%s\t%iM\n",nodeName.c_str(),targetName.c_str(),targetDirection.c_str(),_contig_trim_size);
+            append_format(output.gfa,"L\t%s\t+\t%s\t%s\t%iM\n",nodeName.c_str(),targetName.c_str(),targetDirection.c_str(),_contig_trim_size);
 
     }
-    funlockfile(_gfa_file);
 }
 
 
-set< info_node_t >  Filler::find_nodes_containing_multiple_R(bkpt_dict_t targetDictionary, string linear_seqs_name, int nb_mis_allowed, int nb_gaps_allowed)
+set< info_node_t >  Filler::find_nodes_containing_multiple_R(const AnchorIndex& targetIndex, const string* excluded_target, const std::vector<std::string>& linear_seqs, int nb_mis_allowed, int nb_gaps_allowed)
 {
     //bool debug = false;
     set< info_node_t >  terminal_nodes;
-    BankFasta* Nodes = new BankFasta((char *)linear_seqs_name.c_str());
 
     long nodeNb = 0;
-    char * nodeseq;
-    size_t nodelen;
+    int anchor_size = targetIndex.anchor_size();
 
     // heuristics: R has to be seen entirely in the node up to nb_mis_allowed errors, in the forward strand
-    BankFasta::Iterator  * itSeq  =  new BankFasta::Iterator  (*Nodes);
-
     // We loop over sequences.
-    for (itSeq->first(); !itSeq->isDone(); itSeq->next())
+    for (std::vector<std::string>::const_iterator itSeq = linear_seqs.begin(); itSeq != linear_seqs.end(); itSeq++)
     {
-        int anchor_size = _kmerSize;
-
-        nodelen = (*itSeq)->getDataSize();
-        if (nodelen < _kmerSize )
+        if (itSeq->size() < _kmerSize )
         {
             cout << "Too short" << endl;
             nodeNb++;
             continue;
         }
-        nodeseq =  (*itSeq)->getDataBuffer();
 
+        // best (then leftmost) occurrence of one of the targets in the node
         int best_match=0;
         bkpt_t best_id;
         int position=0;
-        bool arret=false;
-        for (unsigned int j = 0; j < nodelen-_kmerSize+1 && !arret; j++)
+        if (targetIndex.find_best_anchor(itSeq->c_str(), itSeq->size(), nb_mis_allowed, position, best_match, best_id, excluded_target))
         {
-            //best_match = 0; //commented by CL 06/06/18 bug fix (this line prevented to find target kmers with errors in the middle of the contig)
-            
-            for (auto it=targetDictionary.begin(); it !=targetDictionary.end() && !arret; ++it)
-                {
-                    string ide = (it->second).first;
-                    const char * anchor =(it->first).c_str();
-                    int nbmatch=0;
-
-                    for (int i = 0; i < anchor_size; i++)
-                    {
-                        nbmatch += identNT(nodeseq[j+i], anchor[i]);
-                    }
-
-
-                    if (nbmatch > best_match && nbmatch >=(anchor_size - nb_mis_allowed))
-                    {
-                        //cout << "nb match" << nbmatch << endl;
-                        //cout << " target seq" << anchor << endl;
-                        best_id = it->second;
-                        position=j;
-                        best_match = nbmatch;
-                        if (nbmatch == anchor_size) {
-                            arret = true;
-                            break;
-                        }
-                    }
-                }
-        }
-        if (best_match != 0)
-        {
-            //cout << endl;
-            //cout << "cible" << best_id.first << " position " << position << "nodeId" << nodeNb << "  len " << nodelen << endl;
-            //cout << " nodeseq" << nodeseq << endl;
-
-
+            //cout << "cible" << best_id.first << " position " << position << "nodeId" << nodeNb << "  len " << itSeq->size() << endl;
             terminal_nodes.insert((info_node_t) {(int)nodeNb,(int)position, anchor_size - best_match, best_id}); // nodeNb,  j pos of beginning of right anchor
-
         }
 
-
         nodeNb++;
     }
-    /*if (debug)
-    {
-        for(set< info_node_t >::iterator it = terminal_nodes.begin(); it != terminal_nodes.end() ; ++it)
-            fprintf(stderr," (node %d pos %d) ",(*it).node_id,(*it).pos);
-    }*/
 
-    delete itSeq;
-    delete Nodes;
     return terminal_nodes;
 }
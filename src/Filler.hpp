@@ -24,7 +24,12 @@
 /********************************************************************************/
 #include <gatb/gatb_core.hpp>
 #include <GraphOutputDot.hpp>
+#include <GraphOutputMemory.hpp>
 #include <Utils.hpp>
+#include <AnchorIndex.hpp>
+#include <FillDeadline.hpp>
+#include <ExtensionCache.hpp>
+#include <OrderedFillOutput.hpp>
 
 using namespace std;
 
@@ -36,7 +41,12 @@ static const char* STR_CONTIG_OVERLAP = "-overlap";
 static const char* STR_URI_BKPT = "-bkpt";
 static const char* STR_MAX_DEPTH = "-max-length";
 static const char* STR_MAX_NODES = "-max-nodes";
+static const char* STR_MAX_TIME_PER_GAP = "-max-time-per-gap";
+static const char* STR_BIDIRECTIONAL = "-bidirectional";
+static const char* STR_STOP_AT_TARGET = "-stop-at-target";
+static const char* STR_EXTENSION_CACHE = "-extension-cache";
 static const char* STR_FILTER = "-filter";
+static const char* STR_DOT_DEBUG = "-dot-debug";
 
 
  class info_node_t
@@ -84,6 +94,9 @@ public:
 
 
 
+template<size_t span>
+class FillContext;
+
 class Filler : public Tool
 {
 
@@ -111,6 +124,9 @@ public:
     int _nb_breakpoints; //nb seeds in contig mode
     int _nb_filled_breakpoints;
     int _nb_multiple_fill;
+    int _nb_timeouts; //nb gap-fillings stopped by the time limit
+    int _nb_unreachable; //nb gap-fillings not done because the target can not be reached (option -bidirectional)
+    int _nb_reverse_skipped; //nb reverse gap-fillings not done because the forward one showed that there is no path
     int _nb_contigs;
     int _nb_used_contigs;
 
@@ -133,6 +149,10 @@ public:
     //parameters for dbg traversal (stop criteria)
     int _max_depth;
     int _max_nodes;
+    double _max_time_per_gap; //in seconds, 0 : no limit
+    bool _bidirectional; //checks that the target can be reached before each gap-filling of a breakpoint
+    bool _stop_at_target; //stops the extension of a breakpoint gap-filling once its target is found
+    ExtensionCache* _extension_cache; //contigs of the extensions, shared by the gap-fillings with the same source and target (NULL : no cache)
 
     //parameters for looking for the target sequence in the contig graph, with some mismatches and/or gaps
     int _nb_mis_allowed;
@@ -143,6 +163,9 @@ public:
 
     //parameter for filtering out low quality insertions
     bool _filter;
+
+    //debug parameter : also write the contig graph of each gap-filling in a dot file
+    bool _dot_debug;
     
     string _vcf_file_name;
     FILE * _vcf_file;
@@ -153,13 +176,13 @@ public:
 
 
     //these two func moved to public because need access from functors breakpointFunctor and contigFunctor
-    /** writes a given breakpoint in the output file
+    /** writes a given breakpoint in the output of its gap-filling (insertions and info files), see _ordered_output
      */
-    void writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequences, string breakpointName, std::string infostring);
-    void writeToGFA(std::vector<filled_insertion_t>& filledSequences, string sourceSequence, string SeedName, bool isRc);
-    /** writes a given variant in the output vcf file
+    void writeFilledBreakpoint(std::vector<filled_insertion_t>& filledSequences, string breakpointName, std::string infostring, fill_output_t& output);
+    void writeToGFA(std::vector<filled_insertion_t>& filledSequences, string sourceSequence, string SeedName, bool isRc, fill_output_t& output);
+    /** writes a given variant in the output of its gap-filling (vcf file)
      */
-    void writeVcf(std::vector<filled_insertion_t>& filledSequences, string breakpointName, string seedk);
+    void writeVcf(std::vector<filled_insertion_t>& filledSequences, string breakpointName, string seedk, fill_output_t& output);
 
     /** Fill one gap
      */
@@ -167,11 +190,39 @@ public:
     void gapFill(std::string & infostring,int tid,string sourceSequence, string targetSequence, set<filled_insertion_t>& filledSequences, bool begin_kmer_repeated, bool end_kmer_repeated
                  ,bool reversed =false);*/
 
+    /** Fill one gap, from sourceSequence to one of the targets of targetIndex (excluded_target, if given, is ignored : name of a target, with the _Rc suffix if reverse)
+     * with the engines of the calling thread (context)
+     * throws FillTimeoutException if the deadline expires
+     */
+    template<size_t span>
+    void gapFillFromSource(std::string & infostring, FillContext<span>& context, const string& sourceSequence, const string& targetSequence, std::vector<filled_insertion_t>& filledSequences, const AnchorIndex& targetIndex, const string* excluded_target, bool is_anchor_repeated, bool reverse, const FillDeadline& deadline );
+
+    /** records a gap-filling stopped by its time limit (the exception FillTimeoutException was thrown by gapFillFromSource)
+     */
+    void timeoutGapFill(std::string & infostring, std::vector<filled_insertion_t>& filledSequences);
+
+    /** Bidirectional search on the graph between the source and the target kmers (option -bidirectional) :
+     * returns true if neither the gap-filling from the source nor the reverse one can reach their target, false if they may (or if it is unknown)
+     */
     template<size_t span>
-    void gapFillFromSource(std::string & infostring, int tid, string sourceSequence, string targetSequence, std::vector<filled_insertion_t>& filledSequences, bkpt_dict_t targetDictionary,bool is_anchor_repeated, bool reverse );
+    bool isTargetUnreachable(FillContext<span>& context, const string& sourceSequence, const string& targetSequence, bool is_anchor_repeated);
+
+    /** records a gap-filling not done because its target can not be reached (see isTargetUnreachable)
+     */
+    void unreachableGapFill(std::string & infostring);
+
+    /** After a breakpoint gap-filling from the source which found no target, its contigs still being in the context :
+     * returns true if they contain all the kmers that can be reached from the source and from its solid variants,
+     * in which case the reverse gap-filling (from the target to the source) can not find a path either
+     */
+    template<size_t span>
+    bool isReverseFillUseless(FillContext<span>& context, const string& sourceSequence, bool is_anchor_repeated);
 
     gatb::core::tools::dp::IteratorListener* _progress;
 
+    // writes the outputs of the gap-fillings in the input order (they are done the most expensive first)
+    OrderedFillOutput* _ordered_output;
+
 
 private:
 
@@ -200,8 +251,7 @@ private:
     /**
      * returns the nodes containing the targetSequence (can be an approximate match)
      */
-    set< info_node_t >  find_nodes_containing_R(string targetSequence, string linear_seqs_name, int nb_mis_allowed, int nb_gaps_allowed, bool anchor_is_repeated);
-    set< info_node_t> find_nodes_containing_multiple_R(bkpt_dict_t targetDictionary, string linear_seqs_name, int nb_mis_allowed, int nb_gaps_allowed);
+    set< info_node_t> find_nodes_containing_multiple_R(const AnchorIndex& targetIndex, const string* excluded_target, const std::vector<std::string>& linear_seqs, int nb_mis_allowed, int nb_gaps_allowed);
 
     /** Handle on the progress information. */
     void setProgress (gatb::core::tools::dp::IteratorListener* progress)  { SP_SETATTR(progress); }
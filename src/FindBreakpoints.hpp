@@ -32,11 +32,15 @@
 #include <Finder.hpp>
 #include <FindSNP.hpp>
 #include "CircularBuffer.hpp"
+#include <limits> //for std::numeric_limits
 /********************************************************************************/
 
 template<size_t type>
 class IFindObserver;
 
+template<size_t type>
+class FindObservers;
+
 /**
  * \brief An observable functor for find gaps in reference genome
  *
@@ -70,17 +74,25 @@ public :
 
     /** Constructor
      * \param[in] find : A pointeur one Finder instance
+     * \param[in] ref_bloom : Bloom of the repeated (k-1)-mers of the reference genome, shared by all instances (see fillRefBloom)
+     * \param[in] progress : progress listener, shared by all instances
      */
-    FindBreakpoints(Finder * find);
+    FindBreakpoints(Finder * find, IBloom<KmerType>* ref_bloom, gatb::core::tools::dp::IteratorListener* progress);
 
     /** Destructor. */
     virtual ~FindBreakpoints();
     
     //Functor
     /** overloading operator ()
-     * Read reference genome, and find gaps
+     * Read a chunk of the reference genome, and find gaps
+     * \param[in] chunk : the part of the reference to scan, what is found is stored in it
      */
-    void operator()();
+    void operator()(find_chunk_t& chunk);
+
+    /** Builds the Bloom of the repeated (k-1)-mers of the reference genome (occurring more than het_max_occ times),
+     * the parameters given to the Bloom builder are returned in bloom_bit_size and bloom_nb_hash if not NULL
+     */
+    static IBloom<KmerType>* fillRefBloom(Tool* tool, IBank* ref_bank, size_t kmer_size, int het_max_occ, u_int64_t* bloom_bit_size = NULL, size_t* bloom_nb_hash = NULL);
 
     // Observable
     /** Notify gap observer
@@ -88,13 +100,9 @@ public :
      */
     void notify(Node node, bool is_valid);
 
-    /** Add observer call after a gap detection
-     */
-    void addGapObserver(IFindObserver<span>* new_obs);
-
-    /** Add observer call after a gap detection
+    /** Sets the observers called on each kmer and after each gap detection (they are not owned by the FindBreakpoints)
      */
-    void addKmerObserver(IFindObserver<span>* new_obs);
+    void setObservers(FindObservers<span>* observers);
     
     /** writes a given breakpoint in the output file
      */
@@ -104,6 +112,10 @@ public :
      */
     void writeVcfVariant(int bkt_id, string& chrom_name, uint64_t position, char* ref_char, char* alt_char, int repeat_size, string type);
 
+    /** same as above, with REF and ALT given by their first letter and size (not null-terminated, e.g. read in place in the reference)
+     */
+    void writeVcfVariant(int bkt_id, string& chrom_name, uint64_t position, const char* ref_seq, size_t ref_size, const char* alt_seq, size_t alt_size, int repeat_size, string type);
+
 
     /*Getter*/
     /** Return the number of found breakpoints
@@ -177,14 +189,14 @@ public :
 	
 	bool kmer_begin_is_repeated();
 
-    /** Get info_type at the index in circular buffer, rq : limits the kmerSize <256
+    /** History of the last kmers, indexed by het_kmer_begin_index/het_kmer_end_index (and any index around them)
      */
-    info_type& het_kmer_history(unsigned char index);
+    CircularBuffer<KmerType>& het_kmer_history();
 
     /**
      */
-    unsigned char het_kmer_begin_index();
-	unsigned char het_kmer_end_index();
+    size_t het_kmer_begin_index();
+	size_t het_kmer_end_index();
 
     /**
      */
@@ -192,6 +204,11 @@ public :
     int node_in_branch(Node& kmer_node);
     int node_out_branch(Node& kmer_node);
     bool ref_bloom_contains(KmerType kmer);
+
+    /** Is the (k-1)-mer at the given position of the reference (canonical value given) repeated in the reference,
+     * same as ref_bloom_contains, but only asked once for all the samples
+     */
+    bool ref_repeated(uint64_t position, const KmerType& canonical);
     
     /*Iterater*/
     /** Incremente the value of breakpoint_id counter
@@ -241,17 +258,27 @@ public :
     
 private :
 
-    IBloom<KmerType>* fillRefBloom();
-    void store_kmer_info(Node node);
+    /** Sets the look-ahead iterator on the kmer at the given position, data beginning at this position
+     */
+    void lookahead_reset(Data& data, uint64_t position);
+
+    /** Queries the graph once for the current kmer : sets m_in_graph, and the degrees of m_current_info
+     * (only needed to detect the hetero sites, left to 0 otherwise)
+     */
+    void query_kmer(Node& node);
+
+    void store_kmer_info();
 
 private :
 
     /*Observable membre*/
-    std::vector<IFindObserver<span>* > gap_obs;
-    std::vector<IFindObserver<span>* > kmer_obs;
+    FindObservers<span>* m_observers;
 
     /*Find breakpoint membre*/
     /*Write breakpoint*/
+    find_chunk_t* m_chunk;
+    Graph* m_graph; // the graph of the sample of the chunk
+    bool m_owned; // false while the scan is before the positions owned by the chunk
     uint64_t m_breakpoint_id;
     uint64_t m_position;
     char* m_chrom_sequence;
@@ -262,11 +289,21 @@ private :
     KmerCanonical m_previous_kmer;
     KmerIterator m_it_kmer;
 
+    /* Look-ahead on the graph membership of the next kmers : the lookups of a batch of kmers do not depend on each other,
+     * done in a row their memory accesses overlap, instead of being serialized by the observers between two of them */
+    static const uint64_t LOOKAHEAD_SIZE = 256; // must be a power of 2
+    KmerIterator m_lookahead_it; // on the kmer at position m_lookahead_end
+    uint64_t m_lookahead_end; // the membership of the kmers before this position (and at most LOOKAHEAD_SIZE of them) is known
+    uint64_t m_region_end; // no look-ahead beyond this position (end of the bed region)
+    bool m_lookahead_in_graph[LOOKAHEAD_SIZE]; // indexed by position modulo LOOKAHEAD_SIZE
+
     /*Kmer related object*/
     KmerCanonical m_kmer_begin;
     KmerCanonical m_kmer_end;
 
     /*Gap type detection*/
+    bool m_in_graph; // is the current kmer in the graph
+    bool m_with_degrees; // are the degrees of the kmers needed (hetero insertions)
     uint64_t m_solid_stretch_size;
     uint64_t m_gap_stretch_size;
     
@@ -274,21 +311,15 @@ private :
     Finder* finder;
 
     /*Hetero mode*/
-    info_type m_het_kmer_history[256]; 
-    unsigned char m_het_kmer_end_index; // index in history, must remain an unsigned char = same limit as the history array
-    unsigned char m_het_kmer_begin_index;
+    CircularBuffer<KmerType> m_het_kmer_history;
+    size_t m_het_kmer_end_index; // index in history, wrapped by the history itself
+    size_t m_het_kmer_begin_index;
     info_type m_current_info;
     int m_recent_hetero;
     bool m_kmer_end_is_repeated;
 	bool m_kmer_begin_is_repeated;
 
 	
-//	CircularBuffer<info_type> m_het_kmer_history_CB;
-//	typedef typename CircularBuffer<info_type>::itCB  iterCB;
-//	iterCB* m_het_kmer_end_index_CB;
-//	iterCB* m_het_kmer_begin_index_CB;
-	
-	
     /** Bloom of the repeated kmers of the reference genome 
      */
     IBloom<KmerType>* m_ref_bloom;
@@ -306,17 +337,30 @@ private :
 };
 
 template<size_t span>
-FindBreakpoints<span>::FindBreakpoints(Finder * find) : gap_obs(), m_model(find->_kmerSize), m_it_kmer(m_model), _progress (0)
+FindBreakpoints<span>::FindBreakpoints(Finder * find, IBloom<KmerType>* ref_bloom, gatb::core::tools::dp::IteratorListener* progress) : m_observers(NULL), m_model(find->_kmerSize), m_it_kmer(m_model), m_lookahead_it(m_model), _progress (0)
 {
+	this->m_chunk = NULL;
+	this->m_graph = NULL;
+	this->m_owned = false;
+	this->m_in_graph = false;
+	this->m_with_degrees = find->_hete_insert;
 	this->m_breakpoint_id = 1;
 	this->m_position = 0;
+	this->m_lookahead_end = 0;
+	this->m_region_end = 0;
 	this->m_chrom_sequence = NULL;
 	this->m_chrom_name = "";
 	this->m_kmer_begin = KmerCanonical(); // init kmerbegin and kmerend otherwise not init when checking this->_find->kmer_begin().isValid() in update
 	this->m_kmer_end = KmerCanonical();
-	
-	//m_het_kmer_end_index_CB = new iterCB (&m_het_kmer_history_CB);
-	//m_het_kmer_begin_index_CB = new iterCB (&m_het_kmer_history_CB);
+
+	// the history covers the SNP walks around a kmer_begin : every gap of the former 256 kmers history must still fit with the kmers validated around it
+	size_t history_min_size = std::max((size_t)256 + find->_kmerSize + 2, (size_t)4 * find->_kmerSize);
+	int history_powlen = 8;
+	while(((size_t)1 << history_powlen) < history_min_size)
+	{
+		history_powlen++;
+	}
+	this->m_het_kmer_history.resize(history_powlen);
 	
 	/*Homozygote usage*/
 	this->m_solid_stretch_size = 0;
@@ -327,24 +371,16 @@ FindBreakpoints<span>::FindBreakpoints(Finder * find) : gap_obs(), m_model(find-
 	/*Heterozygote usage*/ //always fill repeat ref bloom
 	//if(this->finder->_hete_insert)
 	{
-		this->m_ref_bloom = this->fillRefBloom();
+		this->m_ref_bloom = ref_bloom;
 		this->m_ref_bloom->use();
 	}
+
+	setProgress (progress);
 }
 
 template<size_t span>
 FindBreakpoints<span>::~FindBreakpoints()
 {
-	for(typename std::vector<IFindObserver<span>* >::iterator it = this->kmer_obs.begin(); it != this->kmer_obs.end(); it++)
-	{
-		(*it)->forget();
-	}
-	
-	for(typename std::vector<IFindObserver<span>* >::iterator it = this->gap_obs.begin(); it != this->gap_obs.end(); it++)
-	{
-		(*it)->forget();
-	}
-	
 	//if(this->finder->_hete_insert)  //always fill repeat ref bloom
 		this->m_ref_bloom->forget();
 	
@@ -353,192 +389,201 @@ FindBreakpoints<span>::~FindBreakpoints()
 }
 
 template<size_t span>
-void FindBreakpoints<span>::operator()()
+void FindBreakpoints<span>::operator()(find_chunk_t& chunk)
 {
-	// We create an iterator over this bank
-	Iterator<Sequence>* it_seq = this->finder->_refBank->iterator();
-	LOCAL(it_seq);
-	
-	
-	u_int64_t  totalsize = this->finder->_refBank->estimateSequencesSize();
 	u_int64_t nbkmersdone = 0;
-	
-	//printf("bank size %lli \n",totalsize);
-	setProgress (new ProgressSynchro (
-									  finder->createIteratorListener (totalsize, "Finding breakpoints"), //bon sang le createIteratorListener est dans le tool finder
-									  System::thread().newSynchronizer())
-				 );
-	_progress->init ();
-	
-	
-	
-	// We loop over sequences
-	for (it_seq->first(); !it_seq->isDone(); it_seq->next())
+
+	this->m_chunk = &chunk;
+	this->m_graph = &chunk.sample->graph;
+	this->m_chrom_sequence = &chunk.sequence->data[0];
+	this->m_chrom_name = chunk.sequence->name;
+	uint64_t chrom_length = chunk.sequence->data.size();
+
+	this->m_kmer_begin = KmerCanonical();
+	this->m_kmer_end = KmerCanonical();
+
+	//Reintialize stretch_size for each chunk
+	this->m_solid_stretch_size = 0;
+	this->m_gap_stretch_size = 0;
+
+	// for hetero mode:
+	this->m_het_kmer_history.clear();
+
+	this->m_het_kmer_end_index = this->finder->_kmerSize +1;
+	this->m_het_kmer_begin_index = 1;
+
+	this->m_recent_hetero = 0;
+
+	// The state of the scan (stretch sizes, kmer history, recent hetero site) only depends on the last sync_length kmers
+	// when all of them are solid and none of them can trigger an hetero site (nb_in==2) : at such a sync point,
+	// a scan started anywhere before gives the same result as the scan of the whole sequence.
+	// The chunk scan starts sync_length kmers before the chunk, reports only what is found after its first sync point at or after start,
+	// and stops at the first sync point at or after end, where the scan of the next chunk takes over.
+	uint64_t sync_length = this->finder->_kmerSize + this->finder->_max_repeat + 4;
+	uint64_t sync_run = 0; // number of consecutive solid kmers, without nb_in==2, before the current position
+	uint64_t scan_start = (chunk.start > sync_length) ? chunk.start - sync_length : 0;
+	this->m_owned = (scan_start == chunk.start);
+
+	// restrict to some specific regions of the reference, given in a bed file (sorted and disjoint intervals)
+	bool use_bed = (this->finder->_bed_file_name != "");
+	size_t interval_index = 0;
+	uint64_t start_pos = 0;
+	uint64_t end_pos = 0;
+	if (use_bed)
 	{
+		const bed_regions_t::interval_list_t& interval_vector = *chunk.sequence->intervals;
+		while (interval_index < interval_vector.size() && scan_start >= get<1>(interval_vector[interval_index]))
+		{
+			interval_index++;
+		}
+		if (interval_index == interval_vector.size())
+		{
+			return;
+		}
+		start_pos = get<0>(interval_vector[interval_index]);
+		end_pos = get<1>(interval_vector[interval_index]);
 
-		this->m_kmer_begin = KmerCanonical();
-		this->m_kmer_end = KmerCanonical();
-		//DEBUG
-		//cout<<"sequence "<< (*it_seq)->getCommentShort() << endl;
+		// the kmers before the first region would only reset the scan state, which is already the initial one
+		if (start_pos > scan_start)
+		{
+			if (start_pos + this->finder->_kmerSize > chrom_length)
+			{
+				return;
+			}
+			this->m_het_kmer_begin_index += (start_pos - scan_start);
+			this->m_het_kmer_end_index += (start_pos - scan_start);
+			scan_start = start_pos;
+		}
+	}
 
-		//Reintialize stretch_size for each sequence
-		this->m_solid_stretch_size = 0;
-		this->m_gap_stretch_size = 0;
-		
-		// for hetero mode:
-		memset(this->m_het_kmer_history, 0, sizeof(info_type)*256);
-		//m_het_kmer_history_CB.clear();
-		
-		this->m_het_kmer_end_index = this->finder->_kmerSize +1;
-		this->m_het_kmer_begin_index = 1;
-		
-		//m_het_kmer_end_index_CB->set(this->finder->_kmerSize +1);
-		//m_het_kmer_end_index_CB->set(1);
-		
-		this->m_recent_hetero = 0;
-		
-		// We set the data from which we want to extract kmers.
-		m_it_kmer.setData ((*it_seq)->getData());
-		this->m_chrom_sequence = (*it_seq)->getDataBuffer();
-		this->m_chrom_name = (*it_seq)->getCommentShort();
-		this->m_position = 0;
-		
-        if (this->finder->_bed_file_name=="")
-        {
-            // We iterate the kmers.
-            for (m_it_kmer.first(); !m_it_kmer.isDone(); m_it_kmer.next(), m_position++, m_het_kmer_begin_index++, m_het_kmer_end_index++
-                 ) //,m_het_kmer_begin_index_CB++, m_het_kmer_end_index++
-            {
-                if(!(*m_it_kmer).isValid())
-                {
-                    this->m_solid_stretch_size = 0;
-                    this->m_gap_stretch_size = 0;
-                    this->m_kmer_begin = KmerCanonical();
-                    this->m_kmer_end = KmerCanonical();
-                    //DEBUG
-                    //cout<<"n";
-                }
-                else
-                {
-                    
-                    //we need to convert the kmer in a node to query the graph.
-                    Node node(Node::Value(m_it_kmer->value()), m_it_kmer->strand());// strand is necessary for hetero mode (in/out degree depends on the strand
-                    
-                    uint64_t save_position = m_position; // m_position can be modified by observer (multisnp rev)
-                    
-                    //we notify all observer
-                    this->notify(node, (*m_it_kmer).isValid());
-                    
-                    m_position = save_position;
-                    
-                    //save actual kmer for potential False Positive
-                    m_previous_kmer = *m_it_kmer;
-                    
-                    //if(!graph_contains(node) & (*m_it_kmer).isValid()) {cout << m_position << endl;}
-                    nbkmersdone++;
-                    if (nbkmersdone > 1000)   {  _progress->inc (nbkmersdone);  nbkmersdone = 0;  }
-                }
-            }
-            //DEBUG
-            //cout<<endl;
-        }
-        else{ // restrict to some specific regions of the reference, given in a bed file
-            
-            // read the bed file to construct the set of allowed intervals for this chromosome
-            string line;
-            ifstream reader(this->finder->_bed_file_name);
-            
-            std::vector<tuple<uint64_t ,uint64_t >> interval_vector;
-            //std::vector<tuple<uint64_t ,uint64_t >>::iterator interval_it;
-            while(getline(reader,line))
-            {
-                if ((line.length()==0) ||(line.at(0)=='#') ||(line.at(0)=='@')  ) continue;
-                
-                string token;
-                stringstream iss;
-                vector < string > v;
-                std::tuple<uint64_t ,uint64_t > interval;
-                iss << line;
-                //cout << line << endl;
-                while(getline(iss,token,'\t'))
-                {
-                    v.push_back(token);
-                }
-                if(v[0]==m_chrom_name){ // we are on the current chromosome
-                    interval=std::make_pair(std::stoi(v[1]),std::stoi(v[2]));
-                    interval_vector.push_back( tuple<uint64_t ,uint64_t>(interval));
-                }
-                iss.clear();
-            }
-            
-            if (!interval_vector.empty()){
-                uint64_t  start_pos=get<0>(interval_vector.front());
-                uint64_t  end_pos=get<1>(interval_vector.front());
-             
-                //iterate over the kmers of the chromosome
-                for (m_it_kmer.first(); !m_it_kmer.isDone(); m_it_kmer.next(), m_position++, m_het_kmer_begin_index++, m_het_kmer_end_index++) //,m_het_kmer_begin_index_CB++, m_het_kmer_end_index++
-                {
-                    if (m_position >= end_pos)
-                    {
-                        //move to the next interval
-                        interval_vector.erase(interval_vector.begin());
-                        if(interval_vector.empty()){
-                            break;
-                        }
-                        start_pos=get<0>(interval_vector.front());
-                        end_pos=get<1>(interval_vector.front());
-                    }
-                    
-                    if(!(*m_it_kmer).isValid() || (m_position<start_pos))
-                    {
-                        //Reintialize stretch_size for each bed region
-                        
-                        this->m_solid_stretch_size = 0;
-                        this->m_gap_stretch_size = 0;
-                        this->m_kmer_begin = KmerCanonical();
-                        this->m_kmer_end = KmerCanonical();
-                        //DEBUG
-                        //cout<<"n";
-                    }
-                    
-                    
-                    if(((*m_it_kmer).isValid()) && (m_position>=start_pos)) //inside the current bed interval
-                    {
-                        //we need to convert the kmer in a node to query the graph.
-                        Node node(Node::Value(m_it_kmer->value()), m_it_kmer->strand());// strand is necessary for hetero mode (in/out degree depends on the strand
-                        
-                        uint64_t save_position = m_position; // m_position can be modified by observer (multisnp rev)
-                        
-                        //we notify all observer
-                        this->notify(node, (*m_it_kmer).isValid());
-                        
-                        m_position = save_position;
-                        
-                        //save actual kmer for potential False Positive
-                        m_previous_kmer = *m_it_kmer;
-                        
-                        //if(!graph_contains(node) & (*m_it_kmer).isValid()) {cout << m_position << endl;}
-                        nbkmersdone++;
-                        if (nbkmersdone > 1000)   {  _progress->inc (nbkmersdone);  nbkmersdone = 0;  }
-                    }
-                }
-            }
-        }
-    }
-    
-    _progress->finish ();
+	// the runs of N of the sequence, from the first one not before the scan
+	const ref_sequence_t::run_list_t& n_runs = chunk.sequence->n_runs;
+	size_t n_run_index = std::upper_bound(n_runs.begin(), n_runs.end(), scan_start,
+		[](uint64_t pos, const tuple<uint64_t,uint64_t>& run) { return pos < get<1>(run); }) - n_runs.begin();
+
+	// We set the data from which we want to extract kmers : the sequence from the beginning of the scan
+	Data data (Data::ASCII);
+	data.setRef (this->m_chrom_sequence + scan_start, chrom_length - scan_start);
+	m_it_kmer.setData (data);
+	this->m_position = scan_start;
+	this->m_region_end = use_bed ? end_pos : std::numeric_limits<uint64_t>::max();
+	lookahead_reset(data, scan_start);
+	if (chunk.repeat_cache != NULL)
+	{
+		chunk.repeat_cache->start = scan_start; // the same for the scans of all the samples
+	}
+
+	// We iterate the kmers.
+	for (m_it_kmer.first(); !m_it_kmer.isDone(); m_it_kmer.next(), m_position++, m_het_kmer_begin_index++, m_het_kmer_end_index++)
+	{
+		bool sync_point = (sync_run >= sync_length);
+		if (sync_point && m_position >= chunk.end)
+		{
+			// the next chunk takes over from here
+			break;
+		}
+		if (sync_point && m_position >= chunk.start)
+		{
+			this->m_owned = true;
+		}
+
+		bool in_region = true;
+		if (use_bed)
+		{
+			if (m_position >= end_pos)
+			{
+				//move to the next interval
+				const bed_regions_t::interval_list_t& interval_vector = *chunk.sequence->intervals;
+				interval_index++;
+				if (interval_index == interval_vector.size())
+				{
+					break;
+				}
+				start_pos = get<0>(interval_vector[interval_index]);
+				end_pos = get<1>(interval_vector[interval_index]);
+				this->m_region_end = end_pos;
+			}
+			in_region = (m_position >= start_pos);
+		}
+
+		if(!(*m_it_kmer).isValid() || !in_region)
+		{
+			//Reintialize stretch_size for each sequence part without N (and each bed region)
+			this->m_solid_stretch_size = 0;
+			this->m_gap_stretch_size = 0;
+			this->m_kmer_begin = KmerCanonical();
+			this->m_kmer_end = KmerCanonical();
+			sync_run = 0;
+
+			// the other kmers before the region, or overlapping the same run of N, would only reset the scan again
+			uint64_t jump_pos = 0;
+			if (!in_region)
+			{
+				jump_pos = start_pos;
+			}
+			else
+			{
+				while (n_run_index < n_runs.size() && get<1>(n_runs[n_run_index]) <= m_position)
+				{
+					n_run_index++;
+				}
+				if (n_run_index < n_runs.size() && get<0>(n_runs[n_run_index]) < m_position + this->finder->_kmerSize)
+				{
+					// the first valid kmer can only start after the run, but not after the end of the current region
+					jump_pos = use_bed ? std::min(get<1>(n_runs[n_run_index]), end_pos) : get<1>(n_runs[n_run_index]);
+				}
+			}
+
+			if (jump_pos > m_position + 1)
+			{
+				// jumping there, the iterator is set on the kmer just before it, the loop increment moves everything to jump_pos
+				if (jump_pos + this->finder->_kmerSize > chrom_length)
+				{
+					break;
+				}
+				uint64_t skipped = jump_pos - 1 - m_position;
+				data.setRef (this->m_chrom_sequence + jump_pos - 1, chrom_length - (jump_pos - 1));
+				m_it_kmer.setData (data);
+				m_it_kmer.first();
+				m_position = jump_pos - 1;
+				lookahead_reset(data, jump_pos - 1);
+				m_het_kmer_begin_index += skipped;
+				m_het_kmer_end_index += skipped;
+			}
+		}
+		else
+		{
+			//we need to convert the kmer in a node to query the graph.
+			Node node(Node::Value(m_it_kmer->value()), m_it_kmer->strand());// strand is necessary for hetero mode (in/out degree depends on the strand
+
+			uint64_t save_position = m_position; // m_position can be modified by observer (multisnp rev)
+
+			//we notify all observer
+			this->notify(node, (*m_it_kmer).isValid());
+
+			m_position = save_position;
+
+			//save actual kmer for potential False Positive
+			m_previous_kmer = *m_it_kmer;
+
+			sync_run = (this->m_in_graph && this->m_current_info.nb_in != 2) ? sync_run + 1 : 0;
+
+			nbkmersdone++;
+			if (nbkmersdone > 1000)   {  _progress->inc (nbkmersdone);  nbkmersdone = 0;  }
+		}
+	}
+
+	if (nbkmersdone > 0) {  _progress->inc (nbkmersdone);  }
 }
 
 template<size_t span>
 void FindBreakpoints<span>::notify(Node node, bool is_valid)
 {
-	bool in_graph = this->graph_contains(node);
-	this->store_kmer_info(node);
+	this->query_kmer(node);
+	bool in_graph = this->m_in_graph;
+	this->store_kmer_info();
 	
-	for(typename std::vector<IFindObserver<span>* >::iterator it = this->kmer_obs.begin(); it != this->kmer_obs.end(); it++)
-	{
-		(*it)->update();
-	}
+	this->m_observers->kmer_update();
 	
 	// Kmer is in graph incremente scretch size
 	if(in_graph && is_valid)
@@ -550,16 +595,8 @@ void FindBreakpoints<span>::notify(Node node, bool is_valid)
 		
 		if(m_solid_stretch_size > 1 && m_gap_stretch_size > 0)
 		{
-			// Call each readonly observer
-			for(typename std::vector<IFindObserver<span>* >::iterator it = this->gap_obs.begin(); it != this->gap_obs.end(); it++)
-			{
-				//DEBUG
-				//cout << m_gap_stretch_size << endl;
-				if((*it)->update())
-				{
-					break;
-				}
-			}
+			// Call the gap observers, until one of them explains the gap
+			this->m_observers->gap_update();
 			
 			// gap stretch size is re-set to 0 only when we are sure that the end of the gap is not due to an isolated solid kmer (likely FP)
 			this->m_gap_stretch_size = 0;
@@ -594,72 +631,75 @@ void FindBreakpoints<span>::notify(Node node, bool is_valid)
 }
 
 template<size_t span>
-void FindBreakpoints<span>::addGapObserver(IFindObserver<span>* new_obs)
+void FindBreakpoints<span>::setObservers(FindObservers<span>* observers)
 {
-    new_obs->use();
-    // Add observer in tables use unique_ptr for safety destruction
-    this->gap_obs.push_back(new_obs);
+    this->m_observers = observers;
 }
 
 template<size_t span>
-void FindBreakpoints<span>::addKmerObserver(IFindObserver<span>* new_obs)
-{
-    new_obs->use();
-    // Add observer in tables use unique_ptr for safety destruction
-    this->kmer_obs.push_back(new_obs);
+void FindBreakpoints<span>::writeBreakpoint(int bkt_id, string& chrom_name, uint64_t position, string& kmer_begin, string& kmer_end, int repeat_size, string type, bool repeat_in_genome_kmer_begin, bool repeat_in_genome_kmer_end  ){
+	// before the owned part of the chunk, breakpoints are reported by the previous chunk
+	if(!this->m_owned) return;
+
+	// bkt_id is only local to the chunk, the final id is given by Finder::writeChunk
+	found_variant_t bkpt;
+	bkpt.is_vcf = false;
+	bkpt.chrom_name = chrom_name;
+	bkpt.position = position;
+	bkpt.kmer_begin = kmer_begin;
+	bkpt.kmer_end = kmer_end;
+	bkpt.repeat_in_genome_kmer_begin = repeat_in_genome_kmer_begin;
+	bkpt.repeat_in_genome_kmer_end = repeat_in_genome_kmer_end;
+	bkpt.repeat_size = repeat_size;
+	bkpt.type = type;
+	this->m_chunk->variants.push_back(bkpt);
 }
 
 template<size_t span>
-void FindBreakpoints<span>::writeBreakpoint(int bkt_id, string& chrom_name, uint64_t position, string& kmer_begin, string& kmer_end, int repeat_size, string type, bool repeat_in_genome_kmer_begin, bool repeat_in_genome_kmer_end  ){
-    fprintf(this->finder->_breakpoint_file,">bkpt%i_%s_pos_%lli_fuzzy_%i_%s %s left_kmer\n%s\n>bkpt%i_%s_pos_%lli_fuzzy_%i_%s %s right_kmer\n%s\n",
-	    bkt_id,
-	    chrom_name.c_str(),
-	    position+1, //switch to 1-based
-	    repeat_size,
-	    type.c_str(),
-		repeat_in_genome_kmer_begin ? "REPEATED" : "",
-	    kmer_begin.c_str(),
-	    bkt_id,
-	    chrom_name.c_str(),
-	    position+1, //switch to 1-based
-	    repeat_size,
-	    type.c_str(),
-		repeat_in_genome_kmer_end ? "REPEATED" : "",
-	    kmer_end.c_str()
-	);
+void FindBreakpoints<span>::writeVcfVariant(int bkt_id, string& chrom_name, uint64_t position, char* ref_char, char* alt_char, int repeat_size, string type){
+	if(!this->m_owned) return;
+
+	found_variant_t variant;
+	variant.is_vcf = true;
+	variant.chrom_name = chrom_name;
+	variant.position = position;
+	variant.repeat_in_genome_kmer_begin = false;
+	variant.repeat_in_genome_kmer_end = false;
+	variant.ref = ref_char;
+	variant.alt = alt_char;
+	variant.repeat_size = repeat_size;
+	variant.type = type;
+	this->m_chunk->variants.push_back(variant);
 }
 
 template<size_t span>
-void FindBreakpoints<span>::writeVcfVariant(int bkt_id, string& chrom_name, uint64_t position, char* ref_char, char* alt_char, int repeat_size, string type){
-	//cout << ref_char << alt_char << endl;
-	// NOTE : currently all positions coming from FindObservers are 0-based, VCF is supposed to be 1-based, so we add +1
-	int variant_size=1;
-	if (strcmp(type.c_str(),STR_DEL_TYPE)==0){
-		variant_size = strlen(ref_char) - 1;
-	}
-	fprintf(this->finder->_vcf_file,"%s\t%lli\tbkpt%i\t%s\t%s\t.\tPASS\tTYPE=%s;LEN=%i;FUZZY=%i\tGT\t1/1\n",
-			chrom_name.c_str(),
-			position+1,  //switch to 1-based
-			bkt_id,
-			ref_char,
-			alt_char,
-			type.c_str(),
-			variant_size,
-			repeat_size
-	);
+void FindBreakpoints<span>::writeVcfVariant(int bkt_id, string& chrom_name, uint64_t position, const char* ref_seq, size_t ref_size, const char* alt_seq, size_t alt_size, int repeat_size, string type){
+	if(!this->m_owned) return;
+
+	found_variant_t variant;
+	variant.is_vcf = true;
+	variant.chrom_name = chrom_name;
+	variant.position = position;
+	variant.repeat_in_genome_kmer_begin = false;
+	variant.repeat_in_genome_kmer_end = false;
+	variant.ref.assign(ref_seq, ref_size);
+	variant.alt.assign(alt_seq, alt_size);
+	variant.repeat_size = repeat_size;
+	variant.type = type;
+	this->m_chunk->variants.push_back(variant);
 }
 
 /*Getter*/
 template<size_t span>
 int FindBreakpoints<span>::node_in_branch(Node& kmer_node)
 {
-    return this->finder->_graph.indegree(kmer_node);
+    return this->m_graph->indegree(kmer_node);
 
 }
 template<size_t span>
 int FindBreakpoints<span>::node_out_branch(Node& kmer_node)
 {
-    return this->finder->_graph.outdegree(kmer_node);
+    return this->m_graph->outdegree(kmer_node);
 
 }
 template<size_t span>
@@ -766,23 +806,20 @@ bool FindBreakpoints<span>::kmer_begin_is_repeated()
 }
 
 template<size_t span>
-typename FindBreakpoints<span>::info_type& FindBreakpoints<span>::het_kmer_history(unsigned char index)
+CircularBuffer<typename FindBreakpoints<span>::KmerType>& FindBreakpoints<span>::het_kmer_history()
 {
-    return this->m_het_kmer_history[index];
-	
-//	return  index(); //with index of type iterCB
-
+    return this->m_het_kmer_history;
 }
 
 template<size_t span>
-unsigned char FindBreakpoints<span>::het_kmer_begin_index()
+size_t FindBreakpoints<span>::het_kmer_begin_index()
 {
     return this->m_het_kmer_begin_index;
 }
 
 
 template<size_t span>
-unsigned char FindBreakpoints<span>::het_kmer_end_index()
+size_t FindBreakpoints<span>::het_kmer_end_index()
 {
 	return this->m_het_kmer_end_index;
 }
@@ -793,12 +830,12 @@ unsigned char FindBreakpoints<span>::het_kmer_end_index()
 template<size_t span>
 bool FindBreakpoints<span>::graph_contains(Node& kmer_node)
 {
-    return this->finder->_graph.contains(kmer_node);
+    return this->m_graph->contains(kmer_node);
 	//keep tips and internal node sonly
-	//return	( this->finder->_graph.contains(kmer_node) && (this->finder->_graph.indegree(kmer_node)>=1 || this->finder->_graph.outdegree(kmer_node)>=1 ));
+	//return	( this->m_graph->contains(kmer_node) && (this->m_graph->indegree(kmer_node)>=1 || this->m_graph->outdegree(kmer_node)>=1 ));
 	
 	//keep internal nodes only
-	//	 return	( this->finder->_graph.contains(kmer_node) && (this->finder->_graph.indegree(kmer_node)>=1 && this->finder->_graph.outdegree(kmer_node)>=1 ));
+	//	 return	( this->m_graph->contains(kmer_node) && (this->m_graph->indegree(kmer_node)>=1 && this->m_graph->outdegree(kmer_node)>=1 ));
 	
 }
 
@@ -809,6 +846,31 @@ bool FindBreakpoints<span>::ref_bloom_contains(KmerType kmer)
     
 }
 
+template<size_t span>
+bool FindBreakpoints<span>::ref_repeated(uint64_t position, const KmerType& canonical)
+{
+    repeat_cache_t* cache = this->m_chunk->repeat_cache;
+    if (cache == NULL)
+    {
+        return this->m_ref_bloom->contains(canonical);
+    }
+
+    if (position < cache->start)
+    {
+        return this->m_ref_bloom->contains(canonical);
+    }
+    uint64_t index = position - cache->start;
+    if (index >= cache->status.size())
+    {
+        cache->status.resize(max(index + 1, 2 * cache->status.size()), 0);
+    }
+    if (cache->status[index] == 0)
+    {
+        cache->status[index] = this->m_ref_bloom->contains(canonical) ? 2 : 1;
+    }
+    return cache->status[index] == 2;
+}
+
 
 /*Iterater*/
 template<size_t span>
@@ -820,55 +882,55 @@ uint64_t  FindBreakpoints<span>::breakpoint_id_iterate()
 template<size_t span>
 int FindBreakpoints<span>::homo_fuzzy_iterate()
 {
-    return this->finder->_nb_homo_fuzzy++;
+    return this->m_owned ? this->m_chunk->nb_homo_fuzzy++ : this->m_chunk->nb_homo_fuzzy;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::homo_clean_iterate()
 {
-    return this->finder->_nb_homo_clean++;
+    return this->m_owned ? this->m_chunk->nb_homo_clean++ : this->m_chunk->nb_homo_clean;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::hetero_fuzzy_iterate()
 {
-    return this->finder->_nb_hetero_fuzzy++;
+    return this->m_owned ? this->m_chunk->nb_hetero_fuzzy++ : this->m_chunk->nb_hetero_fuzzy;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::hetero_clean_iterate()
 {
-    return this->finder->_nb_hetero_clean++;
+    return this->m_owned ? this->m_chunk->nb_hetero_clean++ : this->m_chunk->nb_hetero_clean;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::fuzzy_deletion_iterate()
 {
-    return this->finder->_nb_fuzzy_deletion++;
+    return this->m_owned ? this->m_chunk->nb_fuzzy_deletion++ : this->m_chunk->nb_fuzzy_deletion;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::clean_deletion_iterate()
 {
-    return this->finder->_nb_clean_deletion++;
+    return this->m_owned ? this->m_chunk->nb_clean_deletion++ : this->m_chunk->nb_clean_deletion;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::solo_snp_iterate()
 {
-    return this->finder->_nb_solo_snp++;
+    return this->m_owned ? this->m_chunk->nb_solo_snp++ : this->m_chunk->nb_solo_snp;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::multi_snp_iterate()
 {
-    return this->finder->_nb_multi_snp++;
+    return this->m_owned ? this->m_chunk->nb_multi_snp++ : this->m_chunk->nb_multi_snp;
 }
 
 template<size_t span>
 int FindBreakpoints<span>::backup_iterate()
 {
-    return this->finder->_nb_backup++;
+    return this->m_owned ? this->m_chunk->nb_backup++ : this->m_chunk->nb_backup;
 }
 
 /*Setter*/
@@ -881,24 +943,24 @@ void FindBreakpoints<span>::recent_hetero(int value)
 
 //todo later replace this by mphf+ abundance per kmer
 template<size_t span>
-IBloom<typename FindBreakpoints<span>::KmerType>* FindBreakpoints<span>::fillRefBloom(){
+IBloom<typename FindBreakpoints<span>::KmerType>* FindBreakpoints<span>::fillRefBloom(Tool* tool, IBank* ref_bank, size_t kmer_size, int het_max_occ, u_int64_t* bloom_bit_size, size_t* bloom_nb_hash){
 	
 	//Bloom of the repeated (k-1)mers of the reference genome
 	IBloom<KmerType>* ref_bloom = 0;
 	
 	//solid kmers must be stored in a file
-	string tempFileName = this->finder->getInput()->getStr(STR_URI_OUTPUT)+"_trashme.h5";
+	string tempFileName = tool->getInput()->getStr(STR_URI_OUTPUT)+"_trashme.h5";
 	
 	// Parameters for SortingCountAlgorithm // all defaults
 	IProperties* props = SortingCountAlgorithm<>::getDefaultProperties();
-	props->setInt (STR_KMER_ABUNDANCE_MIN, this->finder->_het_max_occ+1);
-	props->setInt (STR_KMER_SIZE,          this->finder->_kmerSize-1);
+	props->setInt (STR_KMER_ABUNDANCE_MIN, het_max_occ+1);
+	props->setInt (STR_KMER_SIZE,          kmer_size-1);
 	props->setStr (STR_URI_OUTPUT,         tempFileName);
 	//Remark : could re-use MAX_DISK or others from Finder options ? not necessary here, small counting in theory
-	//props->setStr (STR_MAX_DISK, this->finder->getInput()->getStr(STR_MAX_DISK));
+	//props->setStr (STR_MAX_DISK, finder->getInput()->getStr(STR_MAX_DISK));
 	
 	/** We create a DSK (kmer counting) instance and execute it. */
-	SortingCountAlgorithm<span> sortingCount (this->finder->_refBank,props);
+	SortingCountAlgorithm<span> sortingCount (ref_bank,props);
 	
 	sortingCount.getInput()->add (0, STR_VERBOSE, 0);//do not show progress bar
 	sortingCount.execute();
@@ -920,57 +982,88 @@ IBloom<typename FindBreakpoints<span>::KmerType>* FindBreakpoints<span>::fillRef
 	size_t nbHash = (int)floorf (0.7*NBITS_PER_KMER);
 	
 	//iterator of KmerCount
-	Iterator<KmerCount>* itKmers = this->finder->createIterator(
+	Iterator<KmerCount>* itKmers = tool->createIterator(
 																solidCollection.iterator(),
 																nb_solid
 																);
 	LOCAL (itKmers);
 	
 	// building the bloom
-	BloomBuilder<span> builder (estimatedBloomSize, nbHash, this->finder->_kmerSize-1, BLOOM_CACHE, this->finder->getDispatcher()->getExecutionUnitsNumber(), this->finder->_het_max_occ+1);
+	BloomBuilder<span> builder (estimatedBloomSize, nbHash, kmer_size-1, BLOOM_CACHE, tool->getDispatcher()->getExecutionUnitsNumber(), het_max_occ+1);
 	ref_bloom = builder.build (itKmers);
 	//cout << typeid(*ref_bloom).name() << endl;  // to verify the type of bloom
 	
 	System::file().remove(tempFileName);
 	
+	if (bloom_bit_size != NULL) *bloom_bit_size = estimatedBloomSize;
+	if (bloom_nb_hash != NULL) *bloom_nb_hash = nbHash;
 	return ref_bloom;
 }
 
 template<size_t span>
-void FindBreakpoints<span>::store_kmer_info(Node node)
+void FindBreakpoints<span>::lookahead_reset(Data& data, uint64_t position)
 {
-	KmerType one; one.setVal(1);
-	KmerType kminus1_mask = (one << ((this->finder->_kmerSize-1)*2)) - one;
-	
-	this->m_current_info.kmer = this->m_it_kmer->forward();
-	if (this->finder->_graph.contains(node))
+	this->m_lookahead_it.setData (data);
+	this->m_lookahead_it.first();
+	this->m_lookahead_end = position;
+}
+
+template<size_t span>
+void FindBreakpoints<span>::query_kmer(Node& node)
+{
+	if (this->m_position >= this->m_lookahead_end)
 	{
-		this->m_current_info.nb_in = this->finder->_graph.indegree (node);
-		this->m_current_info.nb_out = this->finder->_graph.outdegree (node);
+		// querying the next batch of kmers, m_position being the first one
+		uint64_t limit = min(this->m_position + LOOKAHEAD_SIZE, this->m_region_end);
+		for ( ; this->m_lookahead_end < limit && !this->m_lookahead_it.isDone(); this->m_lookahead_it.next(), this->m_lookahead_end++)
+		{
+			bool in_graph = false;
+			if ((*this->m_lookahead_it).isValid() && this->m_lookahead_end >= this->m_position)
+			{
+				Node next_node(Node::Value(this->m_lookahead_it->value()), this->m_lookahead_it->strand());
+				in_graph = this->graph_contains(next_node);
+			}
+			this->m_lookahead_in_graph[this->m_lookahead_end & (LOOKAHEAD_SIZE-1)] = in_graph;
+		}
+	}
+
+	this->m_in_graph = this->m_lookahead_in_graph[this->m_position & (LOOKAHEAD_SIZE-1)];
+	if (this->m_in_graph && this->m_with_degrees)
+	{
+		this->m_current_info.nb_in = this->m_graph->indegree (node);
+		this->m_current_info.nb_out = this->m_graph->outdegree (node);
 	}
 	else
 	{
 		this->m_current_info.nb_in = 0;
 		this->m_current_info.nb_out = 0;
 	}
+}
+
+template<size_t span>
+void FindBreakpoints<span>::store_kmer_info()
+{
+	KmerType one; one.setVal(1);
+	KmerType kminus1_mask = (one << ((this->finder->_kmerSize-1)*2)) - one;
+	
+	this->m_current_info.kmer = this->m_it_kmer->forward();
 	
 	//checking if the k-1 suffix is repeated
 	KmerType suffix = this->m_it_kmer->forward() & kminus1_mask ; // getting the k-1 suffix (because putative kmer_begin)
 	KmerType suffix_rev = revcomp(suffix,this->finder->_kmerSize-1); // we get its reverse complement to compute the canonical value of this k-1-mer
 	
 	//if(this->finder->_hete_insert) //alwayss fill repeat info
-		this->m_current_info.is_repeated = this->m_ref_bloom->contains(min(suffix,suffix_rev));
+		this->m_current_info.is_repeated = this->ref_repeated(this->m_position + 1, min(suffix,suffix_rev));
 	
 	//filling the history array with the current kmer information
-	this->m_het_kmer_history[m_het_kmer_end_index] = m_current_info;
-	//m_het_kmer_end_index_CB->item() = m_current_info ;
+	this->m_het_kmer_history.set(m_het_kmer_end_index, m_current_info.kmer, m_current_info.nb_in, m_current_info.nb_out, m_current_info.is_repeated);
 	
 	//checking if the k-1 prefix is repeated
 	KmerType prefix = (this->m_it_kmer->forward() >> 2) & kminus1_mask; // getting the k-1 prefix (applying kminus1_mask after shifting of 2 bits to get the prefix)
 	KmerType prefix_rev = revcomp(prefix,this->finder->_kmerSize-1); // we get its reverse complement to compute the canonical value of this k-1-mer
 	
 //	if(this->finder->_hete_insert) //alwayss fill repeat info
-		this->m_kmer_end_is_repeated = this->m_ref_bloom->contains(min(prefix,prefix_rev));
+		this->m_kmer_end_is_repeated = this->ref_repeated(this->m_position, min(prefix,prefix_rev));
 }
 
 #endif /* _TOOL_FindBreakpoints_HPP_ */
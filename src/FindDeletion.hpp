@@ -34,6 +34,7 @@ public :
 
     typedef typename Kmer::ModelCanonical KmerModel;
     typedef typename KmerModel::Iterator KmerIterator;
+    typedef typename Kmer::Type KmerType;
     
 public:
 
@@ -48,15 +49,28 @@ public:
 private:
 
     /** Detect if the end of a kmer is equal to the begin of other
-     * \param[in] begin first kmer
-     * \param[in] end the other kmer
+     * \param[in] begin first kmer (forward value)
+     * \param[in] end the other kmer (forward value)
      * \return The size of repetition						
      */
-    unsigned int fuzzy_site(std::string begin, std::string end);
+    unsigned int fuzzy_site(const KmerType& begin, const KmerType& end);
+
+    /** Are all the kmers of the sequence begin (without its last repeat_size nucleotides) followed by end in the graph
+     * \param[in] begin first kmer (forward value)
+     * \param[in] end the other kmer (forward value)
+     * \param[in] repeat_size number of nucleotides removed at the end of begin
+     */
+    bool junction_in_graph(const KmerType& begin, const KmerType& end, unsigned int repeat_size);
+
+    KmerType _kmer_mask;
 };
 
 template<size_t span>
-FindDeletion<span>::FindDeletion(FindBreakpoints<span> * find) : IFindObserver<span>(find){}
+FindDeletion<span>::FindDeletion(FindBreakpoints<span> * find) : IFindObserver<span>(find)
+{
+    KmerType one; one.setVal(1);
+    this->_kmer_mask = (one << (this->_find->kmer_size()*2)) - one;
+}
 
 template<size_t span>
 bool FindDeletion<span>::update()
@@ -71,8 +85,8 @@ bool FindDeletion<span>::update()
 	}
 	
 	// Test if deletion is a fuzzy deletion
-	std::string begin = this->_find->model().toString(this->_find->kmer_begin().forward());
-	std::string end = this->_find->model().toString(this->_find->kmer_end().forward());
+	KmerType begin = this->_find->kmer_begin().forward();
+	KmerType end = this->_find->kmer_end().forward();
 	
 	unsigned int repeat_size = this->fuzzy_site(begin, end);
 	
@@ -81,39 +95,12 @@ bool FindDeletion<span>::update()
 		return false;
 	}
 	
-	if(repeat_size != 0)
-	{
-		begin = begin.substr(0, begin.length() - repeat_size);
-	}
-	
 	// Compute del_size
 	 int del_size = (int) this->_find->gap_stretch_size() -  (int) this->_find->kmer_size() + (int) repeat_size + 1;
 //was size_t, caused computation bug
 
-	
-	// Create a sequence maybe is in graphe
-	std::string seq = begin + end;
-	
-	// Create variable required for iterate on kmer
-	KmerModel local_m(this->_find->kmer_size());
-	KmerIterator local_it(local_m);
-	Data local_d(const_cast<char*>(seq.c_str()));
-	
-	// Init this variable
-	local_d.setRef(const_cast<char*>(seq.c_str()), (size_t)seq.length());
-	local_it.setData(local_d);
-	
-	bool is_deletion = true;
-	for(local_it.first(); !local_it.isDone(); local_it.next())
-	{
-		if(!this->contains(local_it->forward()))
-		{
-			is_deletion = false;
-			break;
-		}
-	}
-	
-	if(is_deletion == false)
+	// The sequence begin (without the repeat) + end maybe is in graphe
+	if(!this->junction_in_graph(begin, end, repeat_size))
 	{
 		if(repeat_size == 0)
 		{
@@ -121,16 +108,9 @@ bool FindDeletion<span>::update()
 		}
 		else // Maybee isn't a fuzzy deletion
 		{
-			seq = this->_find->model().toString(this->_find->kmer_begin().forward()) + end;
-			local_d.setRef(const_cast<char*>(seq.c_str()), (size_t)seq.length());
-			local_it.setData(local_d);
-			
-			for(local_it.first(); !local_it.isDone(); local_it.next())
+			if(!this->junction_in_graph(begin, end, 0))
 			{
-				if(!this->contains(local_it->forward()))
-				{
-					return false;
-				}
+				return false;
 			}
 			
 			del_size -= repeat_size;
@@ -143,24 +123,15 @@ bool FindDeletion<span>::update()
 	if(del_size<=0) return false; //just in case
 	
 	// Write the breakpoint
-	//this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), this->_find->position() - del_size - 1, begin, end, repeat_size, STR_DEL_TYPE);
 	//NOTE : position will always be the left-most when repeat_size>0.
 	size_t del_start_pos = this->_find->position() - 2 - del_size; //begining position of the deletion -1 (0-based): because in VCF we need to put the letter just before the deleted sequence
 
-	//cout << "start pos = " << del_start_pos << "size = " << del_size << endl;
-	char *del_sequence = new char[del_size+2];
-	sprintf(del_sequence,"%.*s", del_size+1, this->_find->chrom_seq()+del_start_pos);
-	char *alt_char = new char[2];
-	sprintf(alt_char,"%.*s", 1, del_sequence);
-	//cout << del_sequence << endl;
-	//cout << alt_char << endl;
+	// REF is the deleted sequence with the letter before it, ALT this letter only, both read in place in the reference
 	// here position is 0-based
+	const char* del_sequence = this->_find->chrom_seq()+del_start_pos;
 	this->_find->writeVcfVariant(this->_find->breakpoint_id(),
 								 this->_find->chrom_name(),
-								 del_start_pos, del_sequence, alt_char, repeat_size, STR_DEL_TYPE);
-	
-	delete [](del_sequence);
-	delete [] (alt_char);
+								 del_start_pos, del_sequence, del_size+1, del_sequence, 1, repeat_size, STR_DEL_TYPE);
 	
 	this->_find->breakpoint_id_iterate();
 	
@@ -175,18 +146,48 @@ bool FindDeletion<span>::update()
 /*
   with max_repeat = 5
   good case 1 + 5 + 1 = 6 operation exemple AAAAATTCGG TTCGGCCCCC
+  the first nucleotide of a kmer is in its high bits : the suffix of size i of begin is its 2i low bits,
+  the prefix of size i of end is end shifted by 2(k-i)
 */
 template<size_t span>
-unsigned int FindDeletion<span>::fuzzy_site(std::string begin, std::string end)
+unsigned int FindDeletion<span>::fuzzy_site(const KmerType& begin, const KmerType& end)
 {
-    for(unsigned int i = this->_find->max_repeat(); i != 0; i--)
-	for(unsigned int j = 1; begin.substr(begin.length() - i, j) == end.substr(0, j); j++)
-	    if(i == j)
-		return j;
-	    
+    size_t kmer_size = this->_find->kmer_size();
+    unsigned int max_i = std::min((size_t)this->_find->max_repeat(), kmer_size);
+
+    KmerType one; one.setVal(1);
+    KmerType zero; zero.setVal(0);
+    for(unsigned int i = max_i; i != 0; i--)
+    {
+        KmerType suffix_mask = (one << (2*i)) - one;
+        if((((end >> (2*(kmer_size - i))) ^ begin) & suffix_mask) == zero)
+            return i;
+    }
+
     return 0;
 }
 
+template<size_t span>
+bool FindDeletion<span>::junction_in_graph(const KmerType& begin, const KmerType& end, unsigned int repeat_size)
+{
+    size_t kmer_size = this->_find->kmer_size();
+
+    // the nucleotides of end are shifted in one by one, the first kmer is complete after repeat_size of them
+    KmerType kmer = begin >> (2*repeat_size);
+    for(size_t j = 0; ; j++)
+    {
+        if(j >= repeat_size && !this->contains(kmer))
+        {
+            return false;
+        }
+        if(j == kmer_size)
+        {
+            return true;
+        }
+        kmer = ((kmer << 2) | ((end >> (2*(kmer_size - 1 - j))) & 3)) & this->_kmer_mask;
+    }
+}
+
 #endif /* _TOOL_FindDeletion_HPP_ */
 
 
@@ -53,10 +53,10 @@ bool FindHeteroInsertion<span>::update()
 			//loop over putative repeat size (0=clean, >0 fuzzy), reports only the smallest repeat size found.
 			for(int i = 0; i <= this->_find->max_repeat(); i++)
 			{
-				if(this->_find->het_kmer_history(this->_find->het_kmer_begin_index()+i).nb_out == 2 && !this->_find->het_kmer_history(this->_find->het_kmer_begin_index()+i).is_repeated)
+				if(this->_find->het_kmer_history().nb_out(this->_find->het_kmer_begin_index()+i) == 2 && !this->_find->het_kmer_history().is_repeated(this->_find->het_kmer_begin_index()+i))
 				{
 					//hetero breakpoint found
-					string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history(this->_find->het_kmer_begin_index()+i).kmer);
+					string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(this->_find->het_kmer_begin_index()+i));
 					//string kmer_end_str = this->_find->model().toString(this->_find->current_info().kmer);
                     //modif 15/06/2018 to check !!! (before in case of fuzzy>0, the end and right kmers overlapped, => insertion of wrong size (- fuzzy), missing the repeat + loss of recall if insertion of size < repeat)
                     string kmer_end_str = string(&(this->_find->chrom_seq()[this->_find->position() + i]), this->_find->kmer_size());
@@ -64,7 +64,7 @@ bool FindHeteroInsertion<span>::update()
                     {
                                return false;
                     }
-                    this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), this->_find->position()-1+i, kmer_begin_str, kmer_end_str,i, STR_HET_TYPE,  this->_find->het_kmer_history(this->_find->het_kmer_begin_index()+i).is_repeated,this->_find->kmer_end_is_repeated() );
+                    this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), this->_find->position()-1+i, kmer_begin_str, kmer_end_str,i, STR_HET_TYPE,  this->_find->het_kmer_history().is_repeated(this->_find->het_kmer_begin_index()+i),this->_find->kmer_end_is_repeated() );
 					
 					this->_find->breakpoint_id_iterate();
 					
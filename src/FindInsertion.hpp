@@ -58,7 +58,7 @@ bool FindCleanInsertion<span>::update()
         
         // Check that kmer_begin has at least one out neighbor, if not the breakpoint is not valid
         
-        string kmer_begin_str_1 = this->_find->model().toString(this->_find->het_kmer_history(this->_find->het_kmer_begin_index()-1).kmer);
+        string kmer_begin_str_1 = this->_find->model().toString(this->_find->het_kmer_history().kmer(this->_find->het_kmer_begin_index()-1));
         if ((this->nb_out_branch(this->_find->kmer_begin().forward())==0) || (this->nb_in_branch(this->_find->kmer_end().forward())==0))
         {
                    return false;
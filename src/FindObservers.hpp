@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk, P.Marijon
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _TOOL_FindObservers_HPP_
+#define _TOOL_FindObservers_HPP_
+
+/*******************************************************************************/
+#include <FindBreakpoints.hpp>
+#include <FindSNP.hpp>
+#include <FindDeletion.hpp>
+#include <FindInsertion.hpp>
+#include <FindBackup.hpp>
+#include <FindHeteroInsertion.hpp>
+
+/** The observers of a FindBreakpoints scan, composed at compile time : each one is a member of its concrete type,
+ * so that their update() calls are resolved statically and can be inlined in FindBreakpoints::notify,
+ * the disabled ones are skipped by a test on a flag.
+ */
+template<size_t span>
+class FindObservers
+{
+public :
+
+    /** Enables the observers of the variants searched by the finder */
+    FindObservers(FindBreakpoints<span>* find, Finder* finder);
+
+    /** Called on each kmer */
+    void kmer_update()
+    {
+        if (_hete_insert) _hetero_insertion.update();
+    }
+
+    /** Called at the end of each gap, the observers are called in this order until one of them explains the gap */
+    void gap_update()
+    {
+        if (_snp && (_solo_snp.update() || _multi_snp.update() || _multi_snp_rev.update())) return;
+        if (_deletion && _deletion_obs.update()) return;
+        if (_homo_insert && (_clean_insertion.update() || _fuzzy_insertion.update())) return;
+        if (_backup) _backup_obs.update();
+    }
+
+private :
+
+    bool _snp;
+    bool _deletion;
+    bool _homo_insert;
+    bool _backup;
+    bool _hete_insert;
+
+    /* Gap observers */
+    FindSoloSNP<span> _solo_snp;
+    FindMultiSNP<span> _multi_snp;
+    FindMultiSNPrev<span> _multi_snp_rev;
+    FindDeletion<span> _deletion_obs;
+    FindCleanInsertion<span> _clean_insertion;
+    FindFuzzyInsertion<span> _fuzzy_insertion;
+    FindBackup<span> _backup_obs;
+
+    /* Kmer observer */
+    FindHeteroInsertion<span> _hetero_insertion;
+};
+
+template<size_t span>
+FindObservers<span>::FindObservers(FindBreakpoints<span>* find, Finder* finder) :
+    _snp(finder->_snp), _deletion(finder->_deletion), _homo_insert(finder->_homo_insert), _backup(finder->_backup), _hete_insert(finder->_hete_insert),
+    _solo_snp(find), _multi_snp(find), _multi_snp_rev(find), _deletion_obs(find), _clean_insertion(find), _fuzzy_insertion(find), _backup_obs(find),
+    _hetero_insertion(find)
+{
+}
+
+#endif /* _TOOL_FindObservers_HPP_ */
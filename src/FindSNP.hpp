@@ -52,11 +52,27 @@ protected :
      */
     KmerType mutate_kmer(KmerType& kmer, KmerType& nuc, size_t pos);
 
-    /** Find the last nucleotide of a kmer in history and remove this nucleotide in the hash map
-     * \param[in] nuc nucleotide hash map
-     * \param[in] pos position of kmer in history
+    /** Test in the graph the kmers obtained by placing each allele of a set at one site of a kmer
+     * \param[in] kmer The kmer to mutate
+     * \param[in] site_mask The two bits of the mutated site set
+     * \param[in] site_nuc The four nucleotides already shifted on the mutated site
+     * \param[in] alleles Bitmask of the nucleotides to test (bit n for nucleotide n)
+     * \return The bitmask of the tested nucleotides giving a kmer of the graph
      */
-    void remove_nuc(std::map<KmerType, unsigned int>& nuc, size_t pos);
+    unsigned int alleles_in_graph(const KmerType& kmer, const KmerType& site_mask, const KmerType* site_nuc, unsigned int alleles);
+
+    /** Count the alleles which validated the kmer and remove the others, if none validated it
+     * the last tested allele is kept and the walk must stop
+     * \param[in,out] alleles Bitmask of the surviving nucleotides
+     * \param[in] found Bitmask of the nucleotides which validated the kmer
+     * \param[in,out] nb_valid Number of kmers validated by each nucleotide
+     * \return true if the walk must stop
+     */
+    bool keep_alleles(unsigned int& alleles, unsigned int found, unsigned int* nb_valid);
+
+    /** The surviving nucleotide which validated the most kmers (the smallest one on ties)
+     */
+    unsigned int best_allele(unsigned int alleles, const unsigned int* nb_valid);
 
     /** Find if we can find a snp at the end of kmer at a position in history
      * \param[in] The position of the first kmer in history
@@ -64,13 +80,13 @@ protected :
      * \param[out] The nucleotide in reads
      * \param[out] The nucleotide in reference
      */
-    bool snp_at_end(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc);
+    bool snp_at_end(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc);
 
-    bool snp_at_end(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val);
+    bool snp_at_end(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val);
     
-    bool snp_at_begin(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc);
+    bool snp_at_begin(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc);
 
-    bool snp_at_begin(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val);
+    bool snp_at_begin(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val);
 
     char nuc_to_char(KmerType nuc);
 };
@@ -116,18 +132,80 @@ char FindSNP<span>::nuc_to_char(KmerType nuc)
     }
 }
 
-//NO LONGER used
 template<size_t span>
-void FindSNP<span>::remove_nuc(std::map<KmerType, unsigned int>& nuc, size_t pos)
+unsigned int FindSNP<span>::alleles_in_graph(const KmerType& kmer, const KmerType& site_mask, const KmerType* site_nuc, unsigned int alleles)
 {
-    //Get the mutate nuc and remove this in map
-    KmerType snp_nuc = this->_find->het_kmer_history(pos).kmer & 3; // obtain the nuc
+    KmerType base = kmer & ~site_mask;
+
+    // canonical form of the (at most three) alternative kmers first, then the graph queries
+    KmerType canonical[4];
+    unsigned int tested[4];
+    size_t nb_tested = 0;
+    for(unsigned int n = 0; n < 4; n++)
+    {
+        if(alleles & (1 << n))
+        {
+            KmerType mutated = base | site_nuc[n];
+            canonical[nb_tested] = std::min(mutated, revcomp(mutated, this->_find->kmer_size()));
+            tested[nb_tested++] = n;
+        }
+    }
 
-    nuc.erase(snp_nuc);
+    unsigned int found = 0;
+    for(size_t i = 0; i < nb_tested; i++)
+    {
+        Node node = Node(Node::Value(canonical[i]));
+        if(this->_find->graph_contains(node))
+        {
+            found |= 1 << tested[i];
+        }
+    }
+    return found;
 }
 
 template<size_t span>
-bool FindSNP<span>::snp_at_end(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc)
+bool FindSNP<span>::keep_alleles(unsigned int& alleles, unsigned int found, unsigned int* nb_valid)
+{
+    for(unsigned int n = 0; n < 4; n++)
+    {
+        if(found & (1 << n))
+        {
+            nb_valid[n]++;
+        }
+    }
+
+    if(found != 0)
+    {
+        alleles = found;
+        return false;
+    }
+
+    // No nucleotide valid this kmer, we keep the last one tested with its count
+    unsigned int last = 3;
+    while(!(alleles & (1 << last)))
+    {
+        last--;
+    }
+    alleles = 1 << last;
+    return true;
+}
+
+template<size_t span>
+unsigned int FindSNP<span>::best_allele(unsigned int alleles, const unsigned int* nb_valid)
+{
+    unsigned int best = 4;
+    for(unsigned int n = 0; n < 4; n++)
+    {
+        if((alleles & (1 << n)) && (best == 4 || nb_valid[n] > nb_valid[best]))
+        {
+            best = n;
+        }
+    }
+    return best;
+}
+
+template<size_t span>
+bool FindSNP<span>::snp_at_end(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc)
 {
     unsigned int tmp;
     return snp_at_end(beginpos, limit, ret_nuc, ref_nuc, &tmp);
@@ -136,69 +214,50 @@ bool FindSNP<span>::snp_at_end(unsigned char* beginpos, size_t limit, KmerType*
 
 // when exiting, beginpos always point to first non solid kmer
 template<size_t span>
-bool FindSNP<span>::snp_at_end(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val) //mute le dernier nt du kmer a position beginpos de listorique puis avance
+bool FindSNP<span>::snp_at_end(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val) //mute le dernier nt du kmer a position beginpos de listorique puis avance
 {
-    // Create map with all nuc A = 0, C = 1, T = 2, G = 3
-    std::map<KmerType, unsigned int> nuc;
-    KmerType zero, un, deux, trois;
-    zero.setVal(0); un.setVal(1); deux.setVal(2); trois.setVal(3);
-    nuc[zero] = 0;
-    nuc[un] = 0;
-    nuc[deux] = 0;
-    nuc[trois] = 0;
-	
-    unsigned char endpos = (*beginpos + limit) % 256;
-	
-    unsigned char  beginpos_init = (*beginpos);
-    //this->remove_nuc(nuc, *beginpos);
-    *ref_nuc = this->_find->het_kmer_history(*beginpos).kmer & 3; // obtain the reference nuc
-    nuc.erase(*ref_nuc);
-	
+    // Nucleotides A = 0, C = 1, T = 2, G = 3, bit n of alleles set while nucleotide n survives
+    unsigned int nb_valid[4] = {0, 0, 0, 0};
+
+    size_t  beginpos_init = (*beginpos);
+    *ref_nuc = this->_find->het_kmer_history().kmer(*beginpos) & 3; // obtain the reference nuc
+    unsigned int alleles = 0xF & ~(1 << ref_nuc->getVal());
+
+    // The mutated site moves from the last nucleotide toward the first one, the masks follow by shifts
+    KmerType site_mask; site_mask.setVal(3);
+    KmerType site_nuc[4];
+    for(unsigned int n = 0; n < 4; n++)
+    {
+        site_nuc[n].setVal(n);
+    }
+
     // if end is false or if didn't read all kmer loop
     bool end = false;
-    for(unsigned char j = 0; !end && j != this->_find->kmer_size(); (*beginpos)++, j++)
+    for(size_t j = 0; !end && j != this->_find->kmer_size(); (*beginpos)++, j++)
 	{
-		// for each nucleotide of nuc map
-		for(typename std::map<KmerType, unsigned int>::iterator nuc_it = nuc.begin(); nuc_it != nuc.end();)
+		unsigned int found = this->alleles_in_graph(this->_find->het_kmer_history().kmer(*beginpos), site_mask, site_nuc, alleles);
+		end = this->keep_alleles(alleles, found, nb_valid);
+		if(end)
 		{
-			KmerType const_fix = nuc_it->first; // fix conversion error
-			KmerType correct_kmer = this->mutate_kmer(this->_find->het_kmer_history(*beginpos).kmer, const_fix, this->_find->kmer_size() - j);
-			if(this->contains(correct_kmer))
-			{
-				nuc[nuc_it->first]++;
-				++nuc_it;
-			}
-			else
-			{
-				
-				if(nuc.size() == 1) //Is the last nucleotide and the last iteration
-				{
-					end = true;
-					(*beginpos) -= 1; // Last iteration didn't create valid kmer we need decrement value //
-					//will still be incr by end of upper for loop
-					
-					break;
-				}
-				nuc.erase(nuc_it++); // This nucleotide didn't valid kmer we remove it
-			}
+			(*beginpos) -= 1; // Last iteration didn't create valid kmer we need decrement value //
+			//will still be incr by end of upper for loop
 		}
-	}
-	
-    //Find the max nucleotide correct most kmer
-    KmerType max = nuc.begin()->first;
-    for(typename std::map<KmerType, unsigned int>::iterator nuc_it = nuc.begin(); nuc_it != nuc.end(); nuc_it++)
-	{
-		if(nuc_it->second > nuc[max])
+
+		site_mask = site_mask << 2;
+		for(unsigned int n = 0; n < 4; n++)
 		{
-			max = nuc_it->first;
+			site_nuc[n] = site_nuc[n] << 2;
 		}
 	}
-	
+
+    //Find the max nucleotide correct most kmer
+    unsigned int max = this->best_allele(alleles, nb_valid);
+
     // If nuc max is upper or equale limit we find a snp
-    if((unsigned int)nuc[max] >= limit)
+    if(nb_valid[max] >= limit)
 	{
-		*ret_nuc = max;
-		*nb_kmer_val = nuc[max];
+		ret_nuc->setVal(max);
+		*nb_kmer_val = nb_valid[max];
 		return true;
 	}
     else
@@ -210,7 +269,7 @@ bool FindSNP<span>::snp_at_end(unsigned char* beginpos, size_t limit, KmerType*
 }
 
 template<size_t span>
-bool FindSNP<span>::snp_at_begin(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc)
+bool FindSNP<span>::snp_at_begin(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc)
 {
     unsigned int tmp;
     return snp_at_begin(beginpos, limit, ret_nuc, ref_nuc, &tmp);
@@ -218,72 +277,53 @@ bool FindSNP<span>::snp_at_begin(unsigned char* beginpos, size_t limit, KmerType
 
 // when exiting, beginpos always point to first non solid kmer
 template<size_t span>
-bool FindSNP<span>::snp_at_begin(unsigned char* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val) //mute le premier nt du kmer a position beginpos de listorique puis recule
+bool FindSNP<span>::snp_at_begin(size_t* beginpos, size_t limit, KmerType* ret_nuc, KmerType* ref_nuc, unsigned int* nb_kmer_val) //mute le premier nt du kmer a position beginpos de listorique puis recule
 {
-	// Create map with all nuc A = 0, C = 1, T = 2, G = 3
-	std::map<KmerType, unsigned int> nuc;
-	KmerType zero, un, deux, trois;
-	zero.setVal(0); un.setVal(1); deux.setVal(2); trois.setVal(3);
-	nuc[zero] = 0;
-	nuc[un] = 0;
-	nuc[deux] = 0;
-	nuc[trois] = 0;
-	
-	
-	unsigned char  beginpos_init = (*beginpos);
-	//this->remove_nuc(nuc, *beginpos - (this->_find->kmer_size()-1));
-	*ref_nuc = (this->_find->het_kmer_history(*beginpos).kmer) >>  (2*(this->_find->kmer_size()-1)) & 3; // obtain the reference nuc
-	//bug : should take first nt here, not last one
-	nuc.erase(*ref_nuc);
-	
-	//printf("snp at begin : bpos %i  : %c \n",*beginpos, this->nuc_to_char(*ref_nuc));
-	
+	// Nucleotides A = 0, C = 1, T = 2, G = 3, bit n of alleles set while nucleotide n survives
+	unsigned int nb_valid[4] = {0, 0, 0, 0};
+
+	size_t  beginpos_init = (*beginpos);
+	*ref_nuc = (this->_find->het_kmer_history().kmer(*beginpos)) >>  (2*(this->_find->kmer_size()-1)) & 3; // obtain the reference nuc
+	unsigned int alleles = 0xF & ~(1 << ref_nuc->getVal());
+
+	// The mutated site moves from the first nucleotide toward the last one, the masks follow by shifts
+	size_t first_shift = 2*(this->_find->kmer_size()-1);
+	KmerType site_mask; site_mask.setVal(3);
+	site_mask = site_mask << first_shift;
+	KmerType site_nuc[4];
+	for(unsigned int n = 0; n < 4; n++)
+	{
+		site_nuc[n].setVal(n);
+		site_nuc[n] = site_nuc[n] << first_shift;
+	}
+
 	// if end is false or if didn't read all kmer loop
 	bool end = false;
-	for(unsigned char j = 0; !end && j != this->_find->kmer_size(); (*beginpos)--, j++)
+	for(size_t j = 0; !end && j != this->_find->kmer_size(); (*beginpos)--, j++)
 	{
-		// for each nucleotide of nuc map
-		for(typename std::map<KmerType, unsigned int>::iterator nuc_it = nuc.begin(); nuc_it != nuc.end();)
+		unsigned int found = this->alleles_in_graph(this->_find->het_kmer_history().kmer(*beginpos), site_mask, site_nuc, alleles);
+		end = this->keep_alleles(alleles, found, nb_valid);
+		if(end)
 		{
-			KmerType const_fix = nuc_it->first; // fix conversion error
-			KmerType correct_kmer = this->mutate_kmer(this->_find->het_kmer_history(*beginpos).kmer, const_fix,  j+1);
-			
-			
-			if(this->contains(correct_kmer))
-			{
-				nuc[nuc_it->first]++;
-				++nuc_it;
-			}
-			else
-			{
-				
-				if(nuc.size() == 1) //Is the last nucleotide and the last iteration
-				{
-					end = true;
-					(*beginpos) += 1; // Last iteration didn't create valid kmer we need decrement value //
-					//will still be incr by end of upper for loop
-					break;
-				}
-				nuc.erase(nuc_it++); // This nucleotide didn't valid kmer we remove it
-			}
+			(*beginpos) += 1; // Last iteration didn't create valid kmer we need decrement value //
+			//will still be incr by end of upper for loop
 		}
-	}
-	
-	//Find the max nucleotide correct most kmer
-	KmerType max = nuc.begin()->first;
-	for(typename std::map<KmerType, unsigned int>::iterator nuc_it = nuc.begin(); nuc_it != nuc.end(); nuc_it++)
-	{
-		if(nuc_it->second > nuc[max])
+
+		site_mask = site_mask >> 2;
+		for(unsigned int n = 0; n < 4; n++)
 		{
-			max = nuc_it->first;
+			site_nuc[n] = site_nuc[n] >> 2;
 		}
 	}
-	
+
+	//Find the max nucleotide correct most kmer
+	unsigned int max = this->best_allele(alleles, nb_valid);
+
 	// If nuc max is upper or equale limit we find a snp
-	if((unsigned int)nuc[max] >= limit)
+	if(nb_valid[max] >= limit)
 	{
-		*ret_nuc = max;
-		*nb_kmer_val = nuc[max];
+		ret_nuc->setVal(max);
+		*nb_kmer_val = nb_valid[max];
 		return true;
 	}
 	else
@@ -294,7 +334,6 @@ bool FindSNP<span>::snp_at_begin(unsigned char* beginpos, size_t limit, KmerType
 	return false;
 }
 
-
 template<size_t span>
 class FindSoloSNP : public FindSNP<span>
 {
@@ -311,7 +350,7 @@ public :
     /** \copydoc IFindObserver::update
      */
     bool update();
-    void correct_history(unsigned char pos, KmerType nuc);
+    void correct_history(size_t pos, KmerType nuc);
 };
 
 template<size_t span>
@@ -329,8 +368,8 @@ bool FindSoloSNP<span>::update()
 	{
 		KmerType ref_nuc; // reference nucleotide
 		KmerType nuc; // alternative nucleotide
-		unsigned char pos = this->_find->het_kmer_begin_index() - 1;
-        unsigned char save_index = pos;
+		size_t pos = this->_find->het_kmer_begin_index() - 1;
+        size_t save_index = pos;
 		if(this->snp_at_end(&pos, this->_find->kmer_size(), &nuc, &ref_nuc))
 		{
 			//string kmer_begin_str = this->_find->model().toString(this->_find->kmer_begin().forward());
@@ -357,25 +396,24 @@ bool FindSoloSNP<span>::update()
 }
 
 template<size_t span>
-void FindSoloSNP<span>::correct_history(unsigned char pos, KmerType nuc)
+void FindSoloSNP<span>::correct_history(size_t pos, KmerType nuc)
 {
     //cout << "history" << endl;
     for(unsigned int i = 0; i != this->_find->kmer_size(); i++)
     {
-        unsigned char index = (i + pos) % 256;
-        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history(index).kmer, nuc, this->_find->kmer_size() - i);
+        size_t index = i + pos;
+        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history().kmer(index), nuc, this->_find->kmer_size() - i);
         
-        //cout << this->_find->model().toString(this->_find->het_kmer_history(index).kmer) << endl;
+        //cout << this->_find->model().toString(this->_find->het_kmer_history().kmer(index)) << endl;
         //cout << this->_find->model().toString(mutated_kmer) << endl;
-        this->_find->het_kmer_history(index).kmer = mutated_kmer;
+        this->_find->het_kmer_history().kmer(index) = mutated_kmer;
         
         if(this->contains(mutated_kmer)){
-            this->_find->het_kmer_history(index).nb_in = this->nb_in_branch(mutated_kmer);
-            this->_find->het_kmer_history(index).nb_out = this->nb_out_branch(mutated_kmer);
-            //cout << "nb_in=" << this->_find->het_kmer_history(index).nb_in << " nb_out=" << this->_find->het_kmer_history(index).nb_out << endl;
+            this->_find->het_kmer_history().set_degrees(index, this->nb_in_branch(mutated_kmer), this->nb_out_branch(mutated_kmer));
+            //cout << "nb_in=" << this->_find->het_kmer_history().nb_in(index) << " nb_out=" << this->_find->het_kmer_history().nb_out(index) << endl;
             //is_repeated :
             //checking if the k-1 suffix is repeated
-            this->_find->het_kmer_history(index).is_repeated = this->suffix_is_repeated(mutated_kmer);
+            this->_find->het_kmer_history().set_repeated(index, this->suffix_is_repeated(mutated_kmer));
         }
         //cout << "--------------------" << endl;
 
@@ -417,11 +455,11 @@ bool FindFuzzySNP<span>::update()
         int delta = this->_find->kmer_size() - this->_find->gap_stretch_size();
         KmerType ref_nuc;
         KmerType nuc;
-        unsigned char pos = this->_find->het_kmer_begin_index() - 1;
+        size_t pos = this->_find->het_kmer_begin_index() - 1;
         if(this->snp_at_end(&pos, this->_find->kmer_size(), &nuc, &ref_nuc))
         {
-            string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history(this->_find->het_kmer_begin_index() - delta - 1).kmer);
-            string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history(pos).kmer);
+            string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(this->_find->het_kmer_begin_index() - delta - 1));
+            string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(pos));
             
             
             this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), this->_find->position() - delta, kmer_begin_str, kmer_end_str, 0, STR_SNP_TYPE);
@@ -451,7 +489,7 @@ public :
      */
     bool update();
 
-    void correct_history(unsigned char pos, KmerType nuc);
+    void correct_history(size_t pos, KmerType nuc);
 };
 
 template<size_t span>
@@ -464,6 +502,11 @@ bool FindMultiSNP<span>::update()
 	{
 		return false;
 	}
+	// safety net : the kmers of the gap and the ones validated around it must still be in the history (longer than any gap of the former history)
+	if(this->_find->gap_stretch_size() + this->_find->kmer_size() + 2 > this->_find->het_kmer_history().size())
+	{
+		return false;
+	}
 	int kmer_threshold = this->_find->snp_min_val();
 	// Not content 2 snp with minimal distance
 	if(this->_find->gap_stretch_size() > this->_find->kmer_size() + kmer_threshold)
@@ -473,16 +516,16 @@ bool FindMultiSNP<span>::update()
 		size_t begin_pos = this->_find->position() -1  - this->_find->gap_stretch_size() + this->_find->kmer_size() - 1;//position dans le genome du snp
 		size_t begin_pos_init = begin_pos;
 
-		// % 256 because buffer history size is equale to 256
-		unsigned char index_end = this->_find->het_kmer_begin_index() + this->_find->kmer_size() - 1; // premier kmer solide
-		unsigned char index_pos = index_end - this->_find->gap_stretch_size(); //premier kmer non solide
+		// indexes are wrapped by the history
+		size_t index_end = this->_find->het_kmer_begin_index() + this->_find->kmer_size() - 1; // premier kmer solide
+		size_t index_pos = index_end - this->_find->gap_stretch_size(); //premier kmer non solide
 
 
 		// We read all kmer in gap
 		while(index_pos != index_end)
 		{
 
-			unsigned char save_index = index_pos;
+			size_t save_index = index_pos;
 			unsigned int nb_kmer_val = 0;
 			KmerType ref_nuc;
 			KmerType nuc;
@@ -497,8 +540,8 @@ bool FindMultiSNP<span>::update()
 				
 				this->correct_history(save_index, nuc);
 				nb_snp++;
-				//string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history(save_index-1).kmer);
-				//string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history(save_index+this->_find->kmer_size()).kmer);
+				//string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(save_index-1));
+				//string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(save_index+this->_find->kmer_size()));
 				//this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), begin_pos , kmer_begin_str, kmer_end_str, 0, STR_MSNP_TYPE);
 
 				char ref_char [2];
@@ -534,7 +577,7 @@ bool FindMultiSNP<span>::update()
 		{
 			this->_find->m_gap_stretch_size -= nb_kmer_correct;
 			this->_find->m_solid_stretch_size += nb_kmer_correct;
-			this->_find->m_kmer_begin.set(this->_find->het_kmer_history(index_pos-1).kmer, revcomp(this->_find->het_kmer_history(index_pos-1).kmer, this->_find->kmer_size()));
+			this->_find->m_kmer_begin.set(this->_find->het_kmer_history().kmer(index_pos-1), revcomp(this->_find->het_kmer_history().kmer(index_pos-1), this->_find->kmer_size()));
 
 
 			return false;
@@ -547,20 +590,19 @@ bool FindMultiSNP<span>::update()
 }
 
 template<size_t span>
-void FindMultiSNP<span>::correct_history(unsigned char pos, KmerType nuc)
+void FindMultiSNP<span>::correct_history(size_t pos, KmerType nuc)
 {
 	for(unsigned int i = 0; i != this->_find->kmer_size(); i++)
 	{
-		unsigned char index = (i + pos) % 256;
-        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history(index).kmer, nuc, this->_find->kmer_size() - i);
-        this->_find->het_kmer_history(index).kmer = mutated_kmer;
+		size_t index = i + pos;
+        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history().kmer(index), nuc, this->_find->kmer_size() - i);
+        this->_find->het_kmer_history().kmer(index) = mutated_kmer;
         if(this->contains(mutated_kmer)){
-            this->_find->het_kmer_history(index).nb_in = this->nb_in_branch(mutated_kmer);
-            this->_find->het_kmer_history(index).nb_out = this->nb_out_branch(mutated_kmer);
+            this->_find->het_kmer_history().set_degrees(index, this->nb_in_branch(mutated_kmer), this->nb_out_branch(mutated_kmer));
             
             //is_repeated :
             //checking if the k-1 suffix is repeated
-            this->_find->het_kmer_history(index).is_repeated = this->suffix_is_repeated(mutated_kmer);
+            this->_find->het_kmer_history().set_repeated(index, this->suffix_is_repeated(mutated_kmer));
         }
 	}
 }
@@ -585,7 +627,7 @@ public :
      */
     bool update();
 	
-    void correct_history(unsigned char pos, KmerType nuc);
+    void correct_history(size_t pos, KmerType nuc);
 };
 
 template<size_t span>
@@ -599,6 +641,12 @@ bool FindMultiSNPrev<span>::update()
 	return false;
     }
 	
+    // safety net : the kmers of the gap and the ones validated around it must still be in the history (longer than any gap of the former history)
+    if(this->_find->gap_stretch_size() + this->_find->kmer_size() + 2 > this->_find->het_kmer_history().size())
+    {
+	return false;
+    }
+
     int kmer_threshold = this->_find->snp_min_val();
 
     if(this->_find->gap_stretch_size() > this->_find->kmer_size() + kmer_threshold)
@@ -608,20 +656,20 @@ bool FindMultiSNPrev<span>::update()
 	size_t begin_pos = this->_find->position() - 2;//position dans le genome du  dernier snp du trou (pos du dernier 0)
 	size_t begin_pos_init = begin_pos;
 		
-	// % 256 because buffer history size is equal to 256
-	unsigned char index_limit = this->_find->het_kmer_end_index() - 2 - this->_find->gap_stretch_size(); // dernier kmer solide avant trou
-	unsigned char index_pos = this->_find->het_kmer_end_index() - 2; //dernier kmer non solide
+	// indexes are wrapped by the history
+	size_t index_limit = this->_find->het_kmer_end_index() - 2 - this->_find->gap_stretch_size(); // dernier kmer solide avant trou
+	size_t index_pos = this->_find->het_kmer_end_index() - 2; //dernier kmer non solide
 		
 //		//debug
 //		printf("histo pos %i \n",index_pos);
-//	KmerType tt = 	 this->_find->het_kmer_history(index_pos).kmer;
+//	KmerType tt = 	 this->_find->het_kmer_history().kmer(index_pos);
 //		cout << tt.toString(this->_find->kmer_size()) << endl;
 ///
 		
 	// We read all kmer in gap
 	while(index_pos != index_limit)
 	{
-		unsigned char save_index = index_pos;
+		size_t save_index = index_pos;
 		unsigned int nb_kmer_val = 0;
 		KmerType ref_nuc;
 		KmerType nuc;
@@ -636,8 +684,8 @@ bool FindMultiSNPrev<span>::update()
 
 			this->correct_history(save_index-( this->_find->kmer_size()-1), nuc);
 			nb_snp++;
-			//string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history(save_index- this->_find->kmer_size() ).kmer);
-			//string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history(save_index+1).kmer);
+			//string kmer_begin_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(save_index- this->_find->kmer_size() ));
+			//string kmer_end_str = this->_find->model().toString(this->_find->het_kmer_history().kmer(save_index+1));
 			//this->_find->writeBreakpoint(this->_find->breakpoint_id(), this->_find->chrom_name(), begin_pos , kmer_begin_str, kmer_end_str, 0, STR_MSNP_TYPE);
 
 			char ref_char [2];
@@ -679,7 +727,7 @@ bool FindMultiSNPrev<span>::update()
 		this->_find->m_gap_stretch_size -= nb_kmer_correct;
 		//cout << " after gap_stretch_size = " << this->_find->m_gap_stretch_size << endl;
 		//this->_find->m_solid_stretch_size += nb_kmer_correct;
-		this->_find->m_kmer_end.set(this->_find->het_kmer_history(index_pos+1).kmer, revcomp(this->_find->het_kmer_history(index_pos+1).kmer, this->_find->kmer_size()));
+		this->_find->m_kmer_end.set(this->_find->het_kmer_history().kmer(index_pos+1), revcomp(this->_find->het_kmer_history().kmer(index_pos+1), this->_find->kmer_size()));
 
 		return false;
 	}
@@ -692,20 +740,19 @@ bool FindMultiSNPrev<span>::update()
 
 //same as findmultisnp
 template<size_t span>
-void FindMultiSNPrev<span>::correct_history(unsigned char pos, KmerType nuc)
+void FindMultiSNPrev<span>::correct_history(size_t pos, KmerType nuc)
 {
     for(unsigned int i = 0; i != this->_find->kmer_size(); i++)
     {
-        unsigned char index = (i + pos) % 256;
-        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history(index).kmer, nuc, this->_find->kmer_size() - i);
-        this->_find->het_kmer_history(index).kmer = mutated_kmer;
+        size_t index = i + pos;
+        KmerType mutated_kmer = this->mutate_kmer(this->_find->het_kmer_history().kmer(index), nuc, this->_find->kmer_size() - i);
+        this->_find->het_kmer_history().kmer(index) = mutated_kmer;
         if(this->contains(mutated_kmer)){
-            this->_find->het_kmer_history(index).nb_in = this->nb_in_branch(mutated_kmer);
-            this->_find->het_kmer_history(index).nb_out = this->nb_out_branch(mutated_kmer);
+            this->_find->het_kmer_history().set_degrees(index, this->nb_in_branch(mutated_kmer), this->nb_out_branch(mutated_kmer));
             
             //is_repeated :
             //checking if the k-1 suffix is repeated
-            this->_find->het_kmer_history(index).is_repeated = this->suffix_is_repeated(mutated_kmer);
+            this->_find->het_kmer_history().set_repeated(index, this->suffix_is_repeated(mutated_kmer));
         }
     }
 }
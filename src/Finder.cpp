@@ -26,15 +26,20 @@
 #include <FindHeteroInsertion.hpp>
 #include <FindInsertion.hpp>
 #include <FindSNP.hpp>
+#include <FindObservers.hpp>
 #include <limits> //for std::numeric_limits
 
 //#define PRINT_DEBUG
 /********************************************************************************/
 
+// the reference sequences are loaded and scanned by batches of this total size (in nt)
+static const u_int64_t FIND_BATCH_SIZE = 100000000;
+
 
 Finder::~Finder()
 {
     if(_refBank != 0) {_refBank->forget();}
+    if(_refIndex != 0) {delete _refIndex;}
     // delete _graph ?
 }
 
@@ -59,22 +64,13 @@ void HelpFinder(void* target)
 Finder::Finder ()  : Tool ("MindTheGap find")
 {
     _refBank = 0;
+    _refIndex = 0;
     _kmerSize = 31;
     _max_repeat = 0;
     _het_max_occ = 1;
     _snp_min_val = 5;
     _nbCores = 0;
-    _breakpoint_file_name = "";
-    _vcf_file_name = "";
-    _nb_homo_clean = 0;
-    _nb_homo_fuzzy = 0;
-    _nb_hetero_clean = 0;
-    _nb_hetero_fuzzy = 0;
-    _nb_fuzzy_deletion = 0;
-    _nb_clean_deletion = 0;
-    _nb_solo_snp = 0;
-    _nb_multi_snp = 0;
-    _nb_backup = 0;
+    _chunk_size = 1000000;
     
     _homo_only = false;
     _homo_insert = true;
@@ -104,8 +100,9 @@ Finder::Finder ()  : Tool ("MindTheGap find")
 	inputParser->push_front (new OptionOneParam (STR_URI_OUTPUT_TMP, "prefix for output temporary files", false, "."));
 	
 	inputParser->push_front (new OptionOneParam (STR_BED, "bed file to restrict breakpoint search in specific regions", false,""));
-    inputParser->push_front (new OptionOneParam (STR_URI_REF, "reference genome file", true,""));
-    inputParser->push_front (new OptionOneParam (STR_URI_GRAPH, "input graph file (likely a hdf5 file)",  false, ""));
+    inputParser->push_front (new OptionOneParam (STR_REF_INDEX, "reference index file, built by MindTheGap index (instead of -ref)", false,""));
+    inputParser->push_front (new OptionOneParam (STR_URI_REF, "reference genome file", false,""));
+    inputParser->push_front (new OptionOneParam (STR_URI_GRAPH, "input graph file (likely a hdf5 file), or several ones separated by a comma to scan the reference once for several samples",  false, ""));
     inputParser->push_front (new OptionOneParam (STR_URI_INPUT, "input read file(s)",  false, ""));
 
     IOptionsParser* finderParser = new OptionsParser("Detection");
@@ -138,6 +135,8 @@ Finder::Finder ()  : Tool ("MindTheGap find")
     finderParser->getParser(STR_NO_HETERO)->setVisible(false);
     finderParser->push_front (new OptionNoParam (STR_WITH_BACKUP, "report also unusual breakpoints (gap size is larger than kmer-size/2 and does not validate a common variant)", false));
     finderParser->getParser(STR_WITH_BACKUP)->setVisible(false);
+    finderParser->push_front (new OptionOneParam (STR_CHUNK_SIZE, "size (in kmers) of the reference chunks scanned in parallel", false, "1000000"));
+    finderParser->getParser(STR_CHUNK_SIZE)->setVisible(false);
 
 
     IOptionsParser* graphParser = new OptionsParser("Graph building");
@@ -169,7 +168,7 @@ Finder::Finder ()  : Tool ("MindTheGap find")
 
 void Finder::FinderHelp()
 {
-	cout << endl << "Usage:  MindTheGap find (-in <reads.fq> | -graph <graph.h5>) -ref <reference.fa> [options]" << endl;
+	cout << endl << "Usage:  MindTheGap find (-in <reads.fq> | -graph <graph.h5>) (-ref <reference.fa> | -ref-index <reference.ref-index>) [options]" << endl;
 	OptionsHelpVisitor v(cout);
 	getParser()->accept(v);
 	throw Exception(); // to get out with EXIT_FAILURE
@@ -194,8 +193,8 @@ void Finder::execute ()
         throw OptionFailure(getParser(), "ERROR: options -graph and -in are incompatible, but at least one of these is mandatory");
     }
     
-    if (getInput()->get(STR_URI_REF) == 0){
-    	throw OptionFailure(getParser(), "ERROR: option -ref is mandatory");
+    if ((getInput()->get(STR_URI_REF) != 0 && getInput()->get(STR_REF_INDEX) != 0) || (getInput()->get(STR_URI_REF) == 0 && getInput()->get(STR_REF_INDEX) == 0)){
+    	throw OptionFailure(getParser(), "ERROR: options -ref and -ref-index are incompatible, but at least one of these is mandatory");
     }
 
 
@@ -257,7 +256,9 @@ void Finder::execute ()
         }
         
         //de Bruijn graph building
-        _graph = Graph::create (getInput());
+        _samples.resize(1);
+        _samples[0].graph_file_name = getInput()->getStr(STR_URI_INPUT);
+        _samples[0].graph = Graph::create (getInput());
 
 		
         _kmerSize = getInput()->getInt(STR_KMER_SIZE);
@@ -268,48 +269,94 @@ void Finder::execute ()
     if (getInput()->get(STR_URI_GRAPH) != 0)
     {
         //fprintf(log,"Loading the graph from file %s\n",getInput()->getStr(STR_URI_GRAPH).c_str());
-        _graph = Graph::load (getInput()->getStr(STR_URI_GRAPH));
-        _kmerSize = _graph.getKmerSize();
+        // several graphs (samples) can be given, separated by commas
+        vector<string> graph_file_names;
+        stringstream graph_list(getInput()->getStr(STR_URI_GRAPH));
+        string graph_file_name;
+        while(getline(graph_list, graph_file_name, ','))
+        {
+            if(graph_file_name != "") graph_file_names.push_back(graph_file_name);
+        }
+        if(graph_file_names.empty())
+        {
+            throw OptionFailure(getParser(), "ERROR: option -graph has no graph file");
+        }
+
+        _samples.resize(graph_file_names.size());
+        for(size_t i = 0; i < graph_file_names.size(); i++)
+        {
+            _samples[i].graph_file_name = graph_file_names[i];
+            _samples[i].graph = Graph::load (graph_file_names[i]);
+            if(i > 0 && _samples[i].graph.getKmerSize() != _kmerSize)
+            {
+                throw Exception("The graphs %s and %s do not have the same kmer size", graph_file_names[0].c_str(), graph_file_names[i].c_str());
+            }
+            _kmerSize = _samples[i].graph.getKmerSize();
+        }
     }
 
     if(getInput()->get(STR_BED) != 0)
     {
         _bed_file_name=getInput()->getStr(STR_BED);
+        _bed_regions.load(_bed_file_name);
     }
 
-    // Preparing the output files
-    _breakpoint_file_name = getInput()->getStr(STR_URI_OUTPUT)+".breakpoints";
-    _breakpoint_file = fopen(_breakpoint_file_name.c_str(), "w");
-    if(_breakpoint_file == NULL){
-        //cerr <<" Cannot open file "<< _output_file <<" for writing" << endl;
-        string message = "Cannot open file "+ _breakpoint_file_name + " for writing";
-        throw Exception(message.c_str());
+    // Getting the reference genome
+    if (getInput()->get(STR_REF_INDEX) != 0)
+    {
+        _refIndex = new RefIndex(getInput()->getStr(STR_REF_INDEX));
+        _ref_file_name = _refIndex->ref_file_name();
     }
-
-    _vcf_file_name = getInput()->getStr(STR_URI_OUTPUT)+".othervariants.vcf";
-    _vcf_file = fopen(_vcf_file_name.c_str(), "w");
-    if(_vcf_file == NULL){
-    	//cerr <<" Cannot open file "<< _output_file <<" for writing" << endl;
-    	string message = "Cannot open file "+ _vcf_file_name + " for writing";
-    	throw Exception(message.c_str());
+    else
+    {
+        //_refBank = new BankFasta(getInput()->getStr(STR_URI_REF));
+        _refBank = Bank::open(getInput()->getStr(STR_URI_REF)); // more general can be a list or a file of files
+        _refBank->use(); //to be able to use the bank several times (do not forget at the end to do _refBank->forget() = delete)
+        _ref_file_name = getInput()->getStr(STR_URI_REF);
     }
-    writeVcfHeader();
-
-    // Getting the reference genome
-    //_refBank = new BankFasta(getInput()->getStr(STR_URI_REF));
-    _refBank = Bank::open(getInput()->getStr(STR_URI_REF)); // more general can be a list or a file of files
-    _refBank->use(); //to be able to use the bank several times (do not forget at the end to do _refBank->forget() = delete)
     
+    // Preparing the output files, with several samples they are prefixed by the output prefix and the name of the graph file
+    if(_samples.size() == 1)
+    {
+        openOutputFiles(_samples[0], getInput()->getStr(STR_URI_OUTPUT));
+    }
+    else
+    {
+        set<string> sample_names;
+        for(size_t i = 0; i < _samples.size(); i++)
+        {
+            string sample_name = _samples[i].graph_file_name.substr(_samples[i].graph_file_name.find_last_of('/') + 1);
+            sample_name = sample_name.substr(0, sample_name.find_last_of('.'));
+            if(!sample_names.insert(sample_name).second)
+            {
+                throw Exception("Several graph files are named %s, their output files would have the same name", sample_name.c_str());
+            }
+            openOutputFiles(_samples[i], getInput()->getStr(STR_URI_OUTPUT) + "_" + sample_name);
+        }
+    }
+
     //Getting other parameters
     _nbCores = getInput()->getInt(STR_NB_CORES);
     _max_repeat = getInput()->getInt(STR_MAX_REPEAT);
     _het_max_occ=getInput()->getInt(STR_HET_MAX_OCC);
     _snp_min_val=getInput()->getInt(STR_SNP_MIN_VAL);
+    if(getInput()->getInt(STR_CHUNK_SIZE) < 1){
+    	throw Exception("The chunk size must be positive");
+    }
+    _chunk_size = getInput()->getInt(STR_CHUNK_SIZE);
 
     if(_het_max_occ<1){
     	_het_max_occ=1;
     }
 
+    // the repeat Bloom of the index depends on these parameters
+    if(_refIndex != 0 && _refIndex->kmer_size() != _kmerSize){
+    	throw Exception("The reference index was built for kmer size %d, not %d", (int) _refIndex->kmer_size(), (int) _kmerSize);
+    }
+    if(_refIndex != 0 && _refIndex->het_max_occ() != _het_max_occ){
+    	throw Exception("The reference index was built with %s %d, not %d", STR_HET_MAX_OCC, _refIndex->het_max_occ(), _het_max_occ);
+    }
+
     if(getInput()->get(STR_HOMO_ONLY) != 0)
     {
 	_homo_only = true;
@@ -394,8 +441,11 @@ void Finder::execute ()
 
     //cout << "in MTG" <<endl;
     // We gather some statistics.
-    fclose(_breakpoint_file);
-    fclose(_vcf_file);
+    for(size_t i = 0; i < _samples.size(); i++)
+    {
+        fclose(_samples[i].breakpoint_file);
+        fclose(_samples[i].vcf_file);
+    }
 
     // Printing result informations (ie. add info to getInfo(), in Tool Info is printed automatically after end of execute() method
     resumeParameters();
@@ -418,39 +468,51 @@ void Finder::resumeParameters(){
     if (getInput()->get(STR_URI_GRAPH) != 0){
         getInfo()->add(2,"Graph",getInput()->getStr(STR_URI_GRAPH).c_str());
     }
-    getInfo()->add(2,"Reference",getInput()->getStr(STR_URI_REF).c_str());
-    getInfo()->add(1,"Graph");
-    getInfo()->add(2,"kmer-size","%i", _kmerSize);
-
-    //In MindTheGap, solidity-kind always at "sum" (not tunable)
-    //getInfo()->add(2,"solidity_kind",_graph.getInfo().getStr("solidity_kind").c_str());
-    try { // use try/catch because this key is present only if auto asked
-    	getInfo()->add(2,"abundance_min (auto inferred)",_graph.getInfo().getStr("cutoffs_auto.values").c_str());
-    } catch (Exception e) {
-    	// doing nothing
-    }
-    string min_abundance;
-    //if(_graph.getInfo().getStr("solidity_kind")=="sum"){
-    int thre = _graph.getInfo().getInt("thresholds"); //with getInt obtains the first number (if sum : threshold = 4 4 if -in had 2 input files, less confusing for the user if only one value shown)
-    stringstream ss;
-    ss << thre;
-    min_abundance = ss.str();
-    //    }
-    //    else{
-    //    	min_abundance = _graph.getInfo().getStr("thresholds").c_str();
-    //    }
-    getInfo()->add(2,"abundance_min (used)",min_abundance);
-
-    try { // version actuelle info manquante si -graph
-    	getInfo()->add(2,"abundance_max",_graph.getInfo().getStr("abundance_max").c_str());
-    } catch (Exception e) {
-    	// doing nothing
-    }
-    try { // entour try/catch ici au cas ou le nom de la cle change dans gatb-core
-    	getInfo()->add(2,"nb_solid_kmers",_graph.getInfo().getStr("kmers_nb_solid").c_str());
-    	getInfo()->add(2,"nb_branching_nodes",_graph.getInfo().getStr("nb_branching").c_str());
-    } catch (Exception e) {
-    	// doing nothing
+    getInfo()->add(2,"Reference",_ref_file_name.c_str());
+    if (_refIndex != 0){
+        getInfo()->add(2,"Reference index",getInput()->getStr(STR_REF_INDEX).c_str());
+    }
+    for(size_t i = 0; i < _samples.size(); i++)
+    {
+        Graph& graph = _samples[i].graph;
+        if (_samples.size() == 1){
+            getInfo()->add(1,"Graph");
+        }
+        else{
+            getInfo()->add(1,"Graph","%s", _samples[i].graph_file_name.c_str());
+        }
+        getInfo()->add(2,"kmer-size","%i", _kmerSize);
+
+        //In MindTheGap, solidity-kind always at "sum" (not tunable)
+        //getInfo()->add(2,"solidity_kind",graph.getInfo().getStr("solidity_kind").c_str());
+        try { // use try/catch because this key is present only if auto asked
+        	getInfo()->add(2,"abundance_min (auto inferred)",graph.getInfo().getStr("cutoffs_auto.values").c_str());
+        } catch (Exception e) {
+        	// doing nothing
+        }
+        string min_abundance;
+        //if(graph.getInfo().getStr("solidity_kind")=="sum"){
+        int thre = graph.getInfo().getInt("thresholds"); //with getInt obtains the first number (if sum : threshold = 4 4 if -in had 2 input files, less confusing for the user if only one value shown)
+        stringstream ss;
+        ss << thre;
+        min_abundance = ss.str();
+        //    }
+        //    else{
+        //    	min_abundance = graph.getInfo().getStr("thresholds").c_str();
+        //    }
+        getInfo()->add(2,"abundance_min (used)",min_abundance);
+
+        try { // version actuelle info manquante si -graph
+        	getInfo()->add(2,"abundance_max",graph.getInfo().getStr("abundance_max").c_str());
+        } catch (Exception e) {
+        	// doing nothing
+        }
+        try { // entour try/catch ici au cas ou le nom de la cle change dans gatb-core
+        	getInfo()->add(2,"nb_solid_kmers",graph.getInfo().getStr("kmers_nb_solid").c_str());
+        	getInfo()->add(2,"nb_branching_nodes",graph.getInfo().getStr("nb_branching").c_str());
+        } catch (Exception e) {
+        	// doing nothing
+        }
     }
 
     getInfo()->add(1,"Breakpoint detection options");
@@ -465,41 +527,65 @@ void Finder::resumeParameters(){
 
 void Finder::resumeResults(double seconds){
     getInfo()->add(0,"Results");
-    getInfo()->add(1,"Insertion breakpoints");
-    getInfo()->add(2,"homozygous","%i", _nb_homo_clean+_nb_homo_fuzzy);
-    getInfo()->add(3,"clean","%i", _nb_homo_clean);
-    getInfo()->add(3,"fuzzy","%i", _nb_homo_fuzzy);
-    getInfo()->add(2,"heterozygous","%i", _nb_hetero_clean+_nb_hetero_fuzzy);
-    getInfo()->add(3,"clean","%i", _nb_hetero_clean);
-    getInfo()->add(3,"fuzzy","%i", _nb_hetero_fuzzy);
-    getInfo()->add(1,"Other variants");
-    getInfo()->add(2,"deletions","%i", _nb_clean_deletion+_nb_fuzzy_deletion);
-    //getInfo()->add(3,"clean", "%i", _nb_clean_deletion);
-    //getInfo()->add(3,"fuzzy", "%i", _nb_fuzzy_deletion);
-    getInfo()->add(2,"SNPs","%i", _nb_solo_snp+_nb_multi_snp);
-    //getInfo()->add(3,"isolated", "%i", _nb_solo_snp);
-    //getInfo()->add(3,"close", "%i", _nb_multi_snp);
-    //getInfo()->add(2,"backup","%i", _nb_backup);
+    // with several samples, their results are given one after the other, one level below
+    size_t d = (_samples.size() == 1) ? 0 : 1;
+    for(size_t i = 0; i < _samples.size(); i++)
+    {
+        find_sample_t& sample = _samples[i];
+        if (d > 0){
+            getInfo()->add(1,"Sample","%s", sample.graph_file_name.c_str());
+        }
+        getInfo()->add(d+1,"Insertion breakpoints");
+        getInfo()->add(d+2,"homozygous","%i", sample.nb_homo_clean+sample.nb_homo_fuzzy);
+        getInfo()->add(d+3,"clean","%i", sample.nb_homo_clean);
+        getInfo()->add(d+3,"fuzzy","%i", sample.nb_homo_fuzzy);
+        getInfo()->add(d+2,"heterozygous","%i", sample.nb_hetero_clean+sample.nb_hetero_fuzzy);
+        getInfo()->add(d+3,"clean","%i", sample.nb_hetero_clean);
+        getInfo()->add(d+3,"fuzzy","%i", sample.nb_hetero_fuzzy);
+        getInfo()->add(d+1,"Other variants");
+        getInfo()->add(d+2,"deletions","%i", sample.nb_clean_deletion+sample.nb_fuzzy_deletion);
+        //getInfo()->add(d+3,"clean", "%i", sample.nb_clean_deletion);
+        //getInfo()->add(d+3,"fuzzy", "%i", sample.nb_fuzzy_deletion);
+        getInfo()->add(d+2,"SNPs","%i", sample.nb_solo_snp+sample.nb_multi_snp);
+        //getInfo()->add(d+3,"isolated", "%i", sample.nb_solo_snp);
+        //getInfo()->add(d+3,"close", "%i", sample.nb_multi_snp);
+        //getInfo()->add(d+2,"backup","%i", sample.nb_backup);
+    }
     getInfo()->add(1,"Time", "%.1f s",seconds);
     getInfo()->add(1,"Output files");
     if(getInput()->get(STR_URI_INPUT) != 0){
             getInfo()->add(2,"graph_file", "%s.h5",getInput()->getStr(STR_URI_OUTPUT).c_str());
         }
-    getInfo()->add(2,"breakpoint_file","%s",_breakpoint_file_name.c_str());
-    getInfo()->add(2,"othervariants_file","%s",_vcf_file_name.c_str());
+    for(size_t i = 0; i < _samples.size(); i++)
+    {
+        getInfo()->add(2,"breakpoint_file","%s",_samples[i].breakpoint_file_name.c_str());
+        getInfo()->add(2,"othervariants_file","%s",_samples[i].vcf_file_name.c_str());
+    }
 
 
 }
 
-void Finder::writeVcfHeader(){
+void Finder::openOutputFiles(find_sample_t& sample, const string& prefix)
+{
+    sample.breakpoint_file_name = prefix+".breakpoints";
+    sample.breakpoint_file = fopen(sample.breakpoint_file_name.c_str(), "w");
+    if(sample.breakpoint_file == NULL){
+        //cerr <<" Cannot open file "<< _output_file <<" for writing" << endl;
+        string message = "Cannot open file "+ sample.breakpoint_file_name + " for writing";
+        throw Exception(message.c_str());
+    }
+
+    sample.vcf_file_name = prefix+".othervariants.vcf";
+    sample.vcf_file = fopen(sample.vcf_file_name.c_str(), "w");
+    if(sample.vcf_file == NULL){
+    	//cerr <<" Cannot open file "<< _output_file <<" for writing" << endl;
+    	string message = "Cannot open file "+ sample.vcf_file_name + " for writing";
+    	throw Exception(message.c_str());
+    }
+    writeVcfHeader(sample);
+}
 
-	string sample="";
-	if (getInput()->get(STR_URI_INPUT) != 0){
-		sample = getInput()->getStr(STR_URI_INPUT);
-	}
-	if (getInput()->get(STR_URI_GRAPH) != 0){
-		sample=getInput()->getStr(STR_URI_GRAPH);
-	}
+void Finder::writeVcfHeader(find_sample_t& sample){
 
 	//getting the date
 	time_t current_time;
@@ -507,7 +593,7 @@ void Finder::writeVcfHeader(){
 	current_time = time(NULL);
 	c_time_string = ctime(&current_time);
 
-	fprintf(_vcf_file,
+	fprintf(sample.vcf_file,
 			"##fileformat=VCFv4.1\n\
 ##filedate=%s\
 ##source=MindTheGap find version %s\n\
@@ -518,46 +604,284 @@ void Finder::writeVcfHeader(){
 ##INFO=<ID=FUZZY,Number=1,Type=Integer,Description=\"repeat size at the breakpoint, only for INS and DEL\">\n\
 ##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n\
 #CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tG1\n",
-c_time_string, _mtg_version, sample.c_str(),getInput()->getStr(STR_URI_REF).c_str());
+c_time_string, _mtg_version, sample.graph_file_name.c_str(),_ref_file_name.c_str());
+}
+
+void ref_sequence_t::find_n_runs()
+{
+    n_runs.clear();
+
+    const char* seq = data.c_str();
+    uint64_t length = data.size();
+    for(uint64_t i = 0; i < length; i++)
+    {
+        if(seq[i] != 'N' && seq[i] != 'n') continue;
+
+        uint64_t start = i;
+        while(i < length && (seq[i] == 'N' || seq[i] == 'n'))
+        {
+            i++;
+        }
+        n_runs.push_back(tuple<uint64_t ,uint64_t>(start, i));
+    }
+}
+
+void bed_regions_t::load(const string& file_name)
+{
+    _regions.clear();
+
+    ifstream reader(file_name);
+    if(!reader)
+    {
+        throw Exception("Cannot open bed file %s", file_name.c_str());
+    }
+
+    string line;
+    while(getline(reader,line))
+    {
+        if ((line.length()==0) ||(line.at(0)=='#') ||(line.at(0)=='@')  ) continue;
+        // UCSC header lines
+        if (line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) continue;
+
+        string token;
+        stringstream iss;
+        vector < string > v;
+        iss << line;
+        while(getline(iss,token,'\t') && v.size() < 3)
+        {
+            v.push_back(token);
+        }
+        if(v.size() < 3)
+        {
+            throw Exception("Bad line in bed file %s : %s", file_name.c_str(), line.c_str());
+        }
+        uint64_t start = 0;
+        uint64_t end = 0;
+        try
+        {
+            start = std::stoull(v[1]);
+            end = std::stoull(v[2]);
+        }
+        catch(std::exception& e)
+        {
+            throw Exception("Bad line in bed file %s : %s", file_name.c_str(), line.c_str());
+        }
+        if(start < end)
+        {
+            _regions[v[0]].push_back(tuple<uint64_t ,uint64_t>(start, end));
+        }
+    }
+
+    // sorting and merging the intervals of each sequence, so that the scan can jump from one to the next
+    // (adjacent intervals are merged too : the scan does not stop between them)
+    for(std::map<string, interval_list_t>::iterator it = _regions.begin(); it != _regions.end(); it++)
+    {
+        interval_list_t& intervals = it->second;
+        std::sort(intervals.begin(), intervals.end());
+
+        size_t nb_merged = 0;
+        for(size_t i = 0; i < intervals.size(); i++)
+        {
+            if(nb_merged > 0 && get<0>(intervals[i]) <= get<1>(intervals[nb_merged-1]))
+            {
+                get<1>(intervals[nb_merged-1]) = max(get<1>(intervals[nb_merged-1]), get<1>(intervals[i]));
+            }
+            else
+            {
+                intervals[nb_merged++] = intervals[i];
+            }
+        }
+        intervals.resize(nb_merged);
+    }
+}
+
+const bed_regions_t::interval_list_t* bed_regions_t::find(const string& sequence_name) const
+{
+    std::map<string, interval_list_t>::const_iterator it = _regions.find(sequence_name);
+    return (it == _regions.end()) ? NULL : &it->second;
+}
+
+void Finder::writeChunk(find_chunk_t& chunk)
+{
+    find_sample_t& sample = *chunk.sample;
+    for(std::vector<found_variant_t>::iterator it = chunk.variants.begin(); it != chunk.variants.end(); it++)
+    {
+        if(it->is_vcf)
+        {
+            writeVcfVariant(sample, sample.breakpoint_id, *it);
+        }
+        else
+        {
+            writeBreakpoint(sample, sample.breakpoint_id, *it);
+        }
+        sample.breakpoint_id++;
+    }
+
+    sample.nb_homo_clean += chunk.nb_homo_clean;
+    sample.nb_homo_fuzzy += chunk.nb_homo_fuzzy;
+    sample.nb_hetero_clean += chunk.nb_hetero_clean;
+    sample.nb_hetero_fuzzy += chunk.nb_hetero_fuzzy;
+    sample.nb_fuzzy_deletion += chunk.nb_fuzzy_deletion;
+    sample.nb_clean_deletion += chunk.nb_clean_deletion;
+    sample.nb_solo_snp += chunk.nb_solo_snp;
+    sample.nb_multi_snp += chunk.nb_multi_snp;
+    sample.nb_backup += chunk.nb_backup;
+}
+
+void Finder::writeBreakpoint(find_sample_t& sample, int bkt_id, found_variant_t& bkpt){
+    fprintf(sample.breakpoint_file,">bkpt%i_%s_pos_%lli_fuzzy_%i_%s %s left_kmer\n%s\n>bkpt%i_%s_pos_%lli_fuzzy_%i_%s %s right_kmer\n%s\n",
+	    bkt_id,
+	    bkpt.chrom_name.c_str(),
+	    bkpt.position+1, //switch to 1-based
+	    bkpt.repeat_size,
+	    bkpt.type.c_str(),
+	    bkpt.repeat_in_genome_kmer_begin ? "REPEATED" : "",
+	    bkpt.kmer_begin.c_str(),
+	    bkt_id,
+	    bkpt.chrom_name.c_str(),
+	    bkpt.position+1, //switch to 1-based
+	    bkpt.repeat_size,
+	    bkpt.type.c_str(),
+	    bkpt.repeat_in_genome_kmer_end ? "REPEATED" : "",
+	    bkpt.kmer_end.c_str()
+	);
+}
+
+void Finder::writeVcfVariant(find_sample_t& sample, int bkt_id, found_variant_t& variant){
+	// NOTE : currently all positions coming from FindObservers are 0-based, VCF is supposed to be 1-based, so we add +1
+	int variant_size=1;
+	if (strcmp(variant.type.c_str(),STR_DEL_TYPE)==0){
+		variant_size = variant.ref.size() - 1;
+	}
+	fprintf(sample.vcf_file,"%s\t%lli\tbkpt%i\t%s\t%s\t.\tPASS\tTYPE=%s;LEN=%i;FUZZY=%i\tGT\t1/1\n",
+			variant.chrom_name.c_str(),
+			variant.position+1,  //switch to 1-based
+			bkt_id,
+			variant.ref.c_str(),
+			variant.alt.c_str(),
+			variant.type.c_str(),
+			variant_size,
+			variant.repeat_size
+	);
 }
 
 template<size_t span>
-void Finder::runFindBreakpoints<span>::operator ()  (Finder* object)
+void Finder::findInBatch(std::vector<ref_sequence_t>& batch, IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* ref_bloom, IteratorListener* progress)
 {
-	FindBreakpoints<span> findBreakpoints(object);
-	
-	/* Add Gap observer */
-	if(object->_snp)
+	// Splitting the sequences in chunks
+	std::vector<find_chunk_t> chunks;
+	for(std::vector<ref_sequence_t>::iterator it = batch.begin(); it != batch.end(); it++)
 	{
-		findBreakpoints.addGapObserver(new FindSoloSNP<span>(&findBreakpoints));
-		//findBreakpoints.addGapObserver(new FindFuzzySNP<span>(&findBreakpoints));
-		findBreakpoints.addGapObserver(new FindMultiSNP<span>(&findBreakpoints));
-		findBreakpoints.addGapObserver(new FindMultiSNPrev<span>(&findBreakpoints));
-
+		if(it->data.size() < _kmerSize) continue; // no kmer
+		if(_bed_file_name != "" && it->intervals == NULL) continue; // no region to scan in this sequence
+
+		u_int64_t nb_kmers = it->data.size() - _kmerSize + 1;
+		for(u_int64_t start = 0; start < nb_kmers; start += _chunk_size)
+		{
+			for(size_t s = 0; s < _samples.size(); s++)
+			{
+				chunks.push_back(find_chunk_t(&(*it), start, min(start + _chunk_size, nb_kmers), &_samples[s]));
+			}
+		}
 	}
-	
-	if(object->_deletion)
+	if(chunks.empty()) return;
+
+	// Scanning the chunks in parallel, each one with its own FindBreakpoints and observers.
+	// The chunks of the samples at the same place of the reference are scanned one after the other by the same thread,
+	// while this piece of reference is in the cache, and the repeat Bloom is asked only by the first one.
+	size_t nb_samples = _samples.size();
+	Range<u_int64_t>::Iterator it_chunk (0, chunks.size()/nb_samples-1);
+	Dispatcher(_nbCores).iterate(it_chunk, [&] (u_int64_t i)
+	{
+		repeat_cache_t repeat_cache;
+		for(size_t s = 0; s < nb_samples; s++)
+		{
+			find_chunk_t& chunk = chunks[i*nb_samples + s];
+			chunk.repeat_cache = (nb_samples > 1) ? &repeat_cache : NULL;
+
+			FindBreakpoints<span> findBreakpoints(this, ref_bloom, progress);
+			FindObservers<span> observers(&findBreakpoints, this);
+			findBreakpoints.setObservers(&observers);
+
+			/* Run */
+			findBreakpoints(chunk);
+		}
+	}, 1);
+
+	// Writing the results in the order of the reference
+	for(std::vector<find_chunk_t>::iterator it = chunks.begin(); it != chunks.end(); it++)
 	{
-		findBreakpoints.addGapObserver(new FindDeletion<span>(&findBreakpoints));
+		writeChunk(*it);
 	}
-	
-	if(object->_homo_insert)
+}
+
+template<size_t span>
+void Finder::addedToBatch(std::vector<ref_sequence_t>& batch, u_int64_t& batch_size, IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* ref_bloom, IteratorListener* progress)
+{
+	ref_sequence_t& sequence = batch.back();
+	if(_bed_file_name != "")
 	{
-		findBreakpoints.addGapObserver(new FindCleanInsertion<span>(&findBreakpoints));
-		findBreakpoints.addGapObserver(new FindFuzzyInsertion<span>(&findBreakpoints));
+		sequence.intervals = _bed_regions.find(sequence.name);
 	}
-	
-	if(object->_backup)
+
+	batch_size += sequence.data.size();
+	if(batch_size >= FIND_BATCH_SIZE)
 	{
-		findBreakpoints.addGapObserver(new FindBackup<span>(&findBreakpoints));
+		findInBatch<span>(batch, ref_bloom, progress);
+		batch.clear();
+		batch_size = 0;
 	}
-	
-	/* Add kmer observer*/
-	if(object->_hete_insert)
+}
+
+template<size_t span>
+void Finder::runFindBreakpoints<span>::operator ()  (Finder* object)
+{
+	typedef typename FindBreakpoints<span>::KmerType KmerType;
+
+	//Bloom of the repeated (k-1)mers of the reference genome, shared by all the chunk scans (already built in the reference index if any)
+	IBloom<KmerType>* ref_bloom = (object->_refIndex != 0) ? object->_refIndex->create_repeat_bloom<span>()
+		: FindBreakpoints<span>::fillRefBloom(object, object->_refBank, object->_kmerSize, object->_het_max_occ);
+	ref_bloom->use();
+
+	u_int64_t ref_size = (object->_refIndex != 0) ? object->_refIndex->total_length() : object->_refBank->estimateSequencesSize();
+	ref_size *= object->_samples.size(); // the reference is scanned for each sample
+	IteratorListener* progress = new ProgressSynchro (
+		object->createIteratorListener (ref_size, "Finding breakpoints"),
+		System::thread().newSynchronizer());
+	progress->use();
+	progress->init ();
+
+	// We loop over sequences, loading them by batches
+	std::vector<ref_sequence_t> batch;
+	u_int64_t batch_size = 0;
+	if (object->_refIndex != 0)
 	{
-		findBreakpoints.addKmerObserver(new FindHeteroInsertion<span>(&findBreakpoints));
+		for (size_t i = 0; i < object->_refIndex->nb_sequences(); i++)
+		{
+			batch.push_back(ref_sequence_t());
+			batch.back().name = object->_refIndex->sequence_name(i);
+			object->_refIndex->get_sequence(i, batch.back().data);
+			object->_refIndex->get_n_runs(i, batch.back().n_runs);
+			object->addedToBatch<span>(batch, batch_size, ref_bloom, progress);
+		}
 	}
-	
-	/* Run */
-	findBreakpoints();
+	else
+	{
+		Iterator<Sequence>* it_seq = object->_refBank->iterator();
+		LOCAL(it_seq);
+
+		for (it_seq->first(); !it_seq->isDone(); it_seq->next())
+		{
+			batch.push_back(ref_sequence_t());
+			batch.back().name = (*it_seq)->getCommentShort();
+			batch.back().data = string((*it_seq)->getDataBuffer(), (*it_seq)->getDataSize());
+			batch.back().find_n_runs();
+			object->addedToBatch<span>(batch, batch_size, ref_bloom, progress);
+		}
+	}
+	object->findInBatch<span>(batch, ref_bloom, progress);
+
+	progress->finish ();
+	progress->forget();
+	ref_bloom->forget();
 }
@@ -23,11 +23,13 @@
 
 /********************************************************************************/
 #include <gatb/gatb_core.hpp>
+#include <RefIndex.hpp>
 using namespace std;
 
 /********************************************************************************/
 
 static const char* STR_URI_REF = "-ref";
+static const char* STR_REF_INDEX = "-ref-index";
 static const char* STR_MAX_REPEAT = "-max-rep";;
 static const char* STR_HET_MAX_OCC = "-het-max-occ";
 static const char* STR_SNP_MIN_VAL = "-snp-min-val";
@@ -44,6 +46,7 @@ static const char* STR_NO_INSERT = "-no-insert";
 static const char* STR_NO_DELETION = "-no-deletion";
 static const char* STR_NO_HETERO = "-no-hetero";
 static const char* STR_BED = "-bed";
+static const char* STR_CHUNK_SIZE = "-chunk-size";
 
 static const char* STR_HOM_TYPE = "HOM";
 static const char* STR_HET_TYPE = "HET";
@@ -52,6 +55,133 @@ static const char* STR_MSNP_TYPE = "MSNP";
 static const char* STR_DEL_TYPE = "DEL";
 static const char* STR_BKP_TYPE = "BACKUP";
 
+/** A breakpoint (or another variant) found by one scan of the reference.
+ * Scans run in parallel, so what they find is kept in memory and written only once all the scans of a batch are done,
+ * in reference order and with the final bkpt ids.
+ */
+class found_variant_t
+{
+public:
+    bool is_vcf; // true: line of the othervariants vcf file, false: pair of kmers of the breakpoint file
+    string chrom_name;
+    uint64_t position;
+    string kmer_begin; // breakpoint file only
+    string kmer_end;
+    bool repeat_in_genome_kmer_begin;
+    bool repeat_in_genome_kmer_end;
+    string ref; // vcf file only
+    string alt;
+    int repeat_size;
+    string type;
+};
+
+/** The regions of a bed file, read once : for each sequence name, the intervals [start,end) sorted and merged
+ */
+class bed_regions_t
+{
+public:
+    typedef std::vector<tuple<uint64_t,uint64_t> > interval_list_t;
+
+    /** reads the bed file, throws an Exception if it can not be read */
+    void load(const string& file_name);
+
+    /** returns the sorted disjoint intervals of the given sequence, NULL if the bed file has none for it */
+    const interval_list_t* find(const string& sequence_name) const;
+
+private:
+    std::map<string, interval_list_t> _regions;
+};
+
+/** A reference sequence, copied from the bank so that several threads can scan it
+ */
+class ref_sequence_t
+{
+public:
+    typedef std::vector<tuple<uint64_t,uint64_t> > run_list_t;
+
+    ref_sequence_t() : intervals(NULL) {}
+
+    /** fills n_runs from data, when the sequence does not come from a reference index */
+    void find_n_runs();
+
+    string name;
+    string data;
+    const bed_regions_t::interval_list_t* intervals; // bed regions of this sequence, only used with -bed
+    run_list_t n_runs; // the stretches [start,end) of N (or n) of data, sorted : the kmers overlapping them are skipped at once
+};
+
+/** A sample of the find run (one per -graph file) : its graph, its output files and what was found in it
+ */
+class find_sample_t
+{
+public:
+    find_sample_t() : breakpoint_file(NULL), vcf_file(NULL),
+        nb_homo_clean(0), nb_homo_fuzzy(0), nb_hetero_clean(0), nb_hetero_fuzzy(0), nb_fuzzy_deletion(0), nb_clean_deletion(0),
+        nb_solo_snp(0), nb_multi_snp(0), nb_backup(0), breakpoint_id(1) {}
+
+    string graph_file_name; // the -in or -graph argument
+    Graph graph;
+    string breakpoint_file_name;
+    FILE * breakpoint_file;
+    string vcf_file_name;
+    FILE * vcf_file;
+
+    int nb_homo_clean;
+    int nb_homo_fuzzy;
+    int nb_hetero_clean;
+    int nb_hetero_fuzzy;
+    int nb_fuzzy_deletion;
+    int nb_clean_deletion;
+    int nb_solo_snp;
+    int nb_multi_snp;
+    int nb_backup;
+
+    int breakpoint_id; // id of the next breakpoint written
+};
+
+/** Whether the (k-1)-mers of a piece of reference are repeated in it, asked to the repeat Bloom by the scan of the first sample
+ * and then known for the scans of the other samples
+ */
+class repeat_cache_t
+{
+public:
+    repeat_cache_t() : start(0) {}
+
+    uint64_t start; // position of the (k-1)-mer of status[0]
+    std::vector<unsigned char> status; // 0: not known yet, 1: not repeated, 2: repeated
+};
+
+/** A piece of a reference sequence, scanned by one FindBreakpoints instance for one sample.
+ * The chunk owns the breakpoints found from position start to position end, the scan begins a bit before start
+ * and stops a bit after end, at a point where the result does no longer depend on where the scan began (see FindBreakpoints::operator()).
+ */
+class find_chunk_t
+{
+public:
+    find_chunk_t(ref_sequence_t* seq, uint64_t start_pos, uint64_t end_pos, find_sample_t* find_sample) : sequence(seq), start(start_pos), end(end_pos),
+        sample(find_sample), repeat_cache(NULL),
+        nb_homo_clean(0), nb_homo_fuzzy(0), nb_hetero_clean(0), nb_hetero_fuzzy(0), nb_fuzzy_deletion(0), nb_clean_deletion(0),
+        nb_solo_snp(0), nb_multi_snp(0), nb_backup(0) {}
+
+    ref_sequence_t* sequence;
+    uint64_t start;
+    uint64_t end;
+    find_sample_t* sample;
+    repeat_cache_t* repeat_cache; // shared by the chunks of the other samples at the same place, NULL with one sample
+
+    std::vector<found_variant_t> variants;
+
+    int nb_homo_clean;
+    int nb_homo_fuzzy;
+    int nb_hetero_clean;
+    int nb_hetero_fuzzy;
+    int nb_fuzzy_deletion;
+    int nb_clean_deletion;
+    int nb_solo_snp;
+    int nb_multi_snp;
+    int nb_backup;
+};
+
 class Finder : public Tool
 {
 public:
@@ -64,12 +194,13 @@ public:
 
     const char* _mtg_version;
     size_t _kmerSize;
-    Graph _graph;
+    std::vector<find_sample_t> _samples; // one per graph, they all have the same kmer size
     //Graph _ref_graph; // no longer used
     int _max_repeat;
     int _het_max_occ;
     int _snp_min_val;
     int _nbCores;
+    u_int64_t _chunk_size; // size (in kmers) of the reference chunks scanned in parallel
     bool _homo_only;
     bool _homo_insert;
     bool _hete_insert;
@@ -77,22 +208,11 @@ public:
     bool _backup;
     bool _deletion;
     IBank* _refBank;
-    string _breakpoint_file_name;
-    FILE * _breakpoint_file;
-    string _vcf_file_name;
-    FILE * _vcf_file;
+    RefIndex* _refIndex; // replaces _refBank with -ref-index
+    string _ref_file_name;
 
     string _bed_file_name;
-
-    int _nb_homo_clean;
-    int _nb_homo_fuzzy;
-    int _nb_hetero_clean;
-    int _nb_hetero_fuzzy;
-    int _nb_fuzzy_deletion;
-    int _nb_clean_deletion;
-    int _nb_solo_snp;
-    int _nb_multi_snp;
-    int _nb_backup;
+    bed_regions_t _bed_regions;
 
     // Actual job done by the tool is here
     void execute ();
@@ -109,14 +229,40 @@ private:
      */
     void resumeResults(double seconds);
 
+    /** opens the output files of the sample, with the given prefix, and writes the header of the vcf file
+     */
+    void openOutputFiles(find_sample_t& sample, const string& prefix);
+
     /** writes the header of the vcf file
          */
-    void writeVcfHeader();
+    void writeVcfHeader(find_sample_t& sample);
+
+    /** writes the variants found in a chunk, numbering the breakpoints, and adds its counts to the results of its sample
+     */
+    void writeChunk(find_chunk_t& chunk);
+
+    /** writes a given breakpoint in the output file
+     */
+    void writeBreakpoint(find_sample_t& sample, int bkt_id, found_variant_t& bkpt);
+
+    /** writes a given variant in the output vcf file
+     */
+    void writeVcfVariant(find_sample_t& sample, int bkt_id, found_variant_t& variant);
 
     /** Create and use FindBreakpoints class to find gaps in the reference genome
      */
     template<size_t span>
     struct runFindBreakpoints {  void operator ()  (Finder* object); };
+
+    /** Scans in parallel a batch of reference sequences, split in chunks, and writes what was found
+     */
+    template<size_t span>
+    void findInBatch(std::vector<ref_sequence_t>& batch, IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* ref_bloom, IteratorListener* progress);
+
+    /** Completes the last sequence added to the batch, and scans the batch if it is large enough
+     */
+    template<size_t span>
+    void addedToBatch(std::vector<ref_sequence_t>& batch, u_int64_t& batch_size, IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* ref_bloom, IteratorListener* progress);
 };
 
 /********************************************************************************/
@@ -56,6 +56,7 @@ int GraphAnalysis::revcomp_node(int node)
 GraphAnalysis::GraphAnalysis(string graph_file_name,size_t kmerSize)
 {
     _sizeKmer =kmerSize;
+    epoch = 0;
     ifstream graph_file (graph_file_name.c_str());
     string line;
 
@@ -69,6 +70,9 @@ GraphAnalysis::GraphAnalysis(string graph_file_name,size_t kmerSize)
     nb_nodes = 0;
     nb_edges = 0;
     char *node_sequence = (char*)malloc(1000000);
+    vector<pair<int,int> > edges;
+
+    sequence_offsets.push_back(0);
 
     getline(graph_file, line);
 
@@ -84,8 +88,8 @@ GraphAnalysis::GraphAnalysis(string graph_file_name,size_t kmerSize)
         if (nb_numbers_seen == 1)
         {
             sscanf(line.c_str(), "%*d %*[^\"]%*[\"]%[A-Z]%*[\"]",node_sequence); // ugly regexp to get the node sequence
-            string str_node_sequence(node_sequence);
-            node_sequences[nb_nodes] = node_sequence;
+            sequence_arena.append(node_sequence);
+            sequence_offsets.push_back(sequence_arena.size());
             nb_nodes++;
         }
         if (nb_numbers_seen == 2)
@@ -104,21 +108,122 @@ GraphAnalysis::GraphAnalysis(string graph_file_name,size_t kmerSize)
             	continue;
             }
 
-            if (out_edges[node_a].find(node_b) == out_edges[node_a].end())
-            {
-                out_edges[node_a].insert(node_b);
-                in_edges[node_b].insert(node_a);
-                nb_edges++;
-            }
+            edges.push_back(make_pair(node_a,node_b));
         }
     }
 
     free(node_sequence);
+    build_adjacency(edges);
     //printf("finished parsing %s: %d nodes and %d edges found\n", graph_file_name.c_str(), nb_nodes, nb_edges);
 }
 
+// same graph as the one parsed from a dot file, but directly from the memory (see GraphOutputMemory)
+GraphAnalysis::GraphAnalysis(const contig_graph_t& contig_graph,size_t kmerSize)
+{
+    epoch = 0;
+    load(contig_graph, kmerSize);
+}
+
+GraphAnalysis::GraphAnalysis()
+{
+    _sizeKmer = 0;
+    nb_nodes = 0;
+    nb_edges = 0;
+    epoch = 0;
+}
+
+void GraphAnalysis::load(const contig_graph_t& contig_graph,size_t kmerSize)
+{
+    _sizeKmer =kmerSize;
+    nb_nodes = 0;
+    nb_edges = 0;
+    vector<pair<int,int> >& edges = edge_buffer;
+    edges.clear();
+
+    sequence_arena.clear();
+    sequence_offsets.clear();
+    sequence_offsets.push_back(0);
+    for (vector<string>::const_iterator it = contig_graph.node_sequences.begin(); it != contig_graph.node_sequences.end(); it++)
+    {
+        sequence_arena.append(*it);
+        sequence_offsets.push_back(sequence_arena.size());
+        nb_nodes++;
+    }
+
+    for (vector<contig_edge_t>::const_iterator it = contig_graph.edges.begin(); it != contig_graph.edges.end(); it++)
+    {
+        //Here we have only FF overlaps between contigs (+ bugs if uses the R overlaps)
+        if (it->label[0] == 'R' || it->label[1] == 'R'){
+            continue;
+        }
+
+        edges.push_back(make_pair((int)it->from,(int)it->to));
+    }
+
+    build_adjacency(edges);
+}
+
+void GraphAnalysis::build_adjacency(vector<pair<int,int> >& edges)
+{
+    int nb_vertices = 2*nb_nodes;
+
+    for (vector<pair<int,int> >::iterator it = edges.begin(); it != edges.end(); it++)
+    {
+        it->first = node_to_vertex(it->first);
+        it->second = node_to_vertex(it->second);
+    }
+
+    // sorting by (source, target) gives the out rows in order, and removes the duplicated edges
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    nb_edges = edges.size();
+
+    out_offsets.assign(nb_vertices+1, 0);
+    in_offsets.assign(nb_vertices+1, 0);
+    for (vector<pair<int,int> >::iterator it = edges.begin(); it != edges.end(); it++)
+    {
+        out_offsets[it->first+1]++;
+        in_offsets[it->second+1]++;
+    }
+    for (int v = 0; v < nb_vertices; v++)
+    {
+        out_offsets[v+1] += out_offsets[v];
+        in_offsets[v+1] += in_offsets[v];
+    }
+
+    out_neighbors.resize(nb_edges);
+    in_neighbors.resize(nb_edges);
+    in_fill.assign(in_offsets.begin(), in_offsets.end()-1);
+    for (int e = 0; e < nb_edges; e++)
+    {
+        out_neighbors[e] = edges[e].second;
+        // edges are sorted by source, so each in row is also sorted
+        in_neighbors[in_fill[edges[e].second]++] = edges[e].first;
+    }
+}
+
+void GraphAnalysis::set_terminal_nodes(const set< info_node_t >& terminal_nodes_with_endpos)
+{
+    if (terminal_epoch.size() < (size_t) 2*nb_nodes)
+    {
+        terminal_epoch.resize(2*nb_nodes, 0);
+    }
+    epoch++;
+    if (epoch == 0)
+    {
+        // the counter wrapped : the old marks could be taken for the new ones
+        std::fill(terminal_epoch.begin(), terminal_epoch.end(), 0);
+        epoch = 1;
+    }
+
+    for (set< info_node_t >::const_iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
+    {
+        terminal_epoch[node_to_vertex(it_targets->node_id)] = epoch;
+    }
+}
+
 // wrapper
-set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(set< info_node_t > terminal_nodes_with_endpos, bool &success)
+set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(const set< info_node_t >& terminal_nodes_with_endpos, bool &success)
 {
     success = true;
     unlabeled_path start_path;
@@ -133,7 +238,7 @@ set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(set< info_node_t
 }
 
 // precondition: terminal_nodes is non-empty
-set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(int start_node, set< info_node_t > terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success)
+set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(int start_node, const set< info_node_t >& terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success)
 {
     //cout << nb_calls << endl;
 
@@ -148,7 +253,7 @@ set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(int start_node, s
         return paths;
     }
 
-    for (set< info_node_t >::iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
+    for (set< info_node_t >::const_iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
     {
         if (it_targets->node_id == start_node )
         {
@@ -163,9 +268,10 @@ set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(int start_node, s
 //        return paths;
 //    }
     // visit all neighbors
-    for(set<int>::iterator it_edge = out_edges[start_node].begin(); it_edge != out_edges[start_node].end(); it_edge++)
+    int start_vertex = node_to_vertex(start_node);
+    for(int e = out_offsets[start_vertex]; e < out_offsets[start_vertex+1]; e++)
     {
-        int next_node = *it_edge;
+        int next_node = vertex_to_node(out_neighbors[e]);
 
         // each node of the graph is used in a path at most once (as a consequence, we won't gapfill some tandem repeats)
         if (find(current_path.begin(), current_path.end(), next_node) == current_path.end())
@@ -202,133 +308,160 @@ set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths(int start_node, s
 
 //Find all paths between L and R, but starting from R towards L  (much more faster and efficient)
 // wrapper
-set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths_rev(set< info_node_t > terminal_nodes_with_endpos)
+set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths_rev(const set< info_node_t >& terminal_nodes_with_endpos, const FillDeadline* deadline)
 {
     //storing all the paths in a set
 	set<pair<unlabeled_path,bkpt_t>> all_paths;
-    
+
+    set_terminal_nodes(terminal_nodes_with_endpos);
+    if (on_path.size() < (size_t) 2*nb_nodes)
+    {
+        on_path.resize(2*nb_nodes, false);
+    }
+
     // Loop over all terminal nodes, will start a DFS for each terminal node : from terminal node towards node 0
-	for (set< info_node_t >::iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
+	for (set< info_node_t >::const_iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
     {
     	int terminal_node = it_targets->node_id;
         bkpt_t target_id = it_targets->targetId;
-        
-    	bool success = true;
-    	unlabeled_path start_path;
-		start_path.push_back(terminal_node);
-    	int nb_calls = 0;
-        
+
         //speed-up : if one of the terminal node is 0, return one path (0), hopefully terminal nodes are sorted, if 0 is a terminal node, it is the first of the list.
         if (terminal_node == 0){
             set<pair<unlabeled_path,bkpt_t>> the_path;
-            the_path.insert(make_pair(start_path, target_id));
+            the_path.insert(make_pair(unlabeled_path(1, terminal_node), target_id));
             return the_path;
         }
 
         //cout << "For terminal node=" << terminal_node << endl;
-		set<pair<unlabeled_path,bkpt_t>> paths = find_all_paths_rev(terminal_node, terminal_nodes_with_endpos, start_path, nb_calls, success, terminal_node, target_id);
-        
-		all_paths.insert(paths.begin(), paths.end());
-    //std::cout << "PATHS0 \n"  << endl;
+        path_buffer.clear();
+        path_offsets.assign(1, 0);
+        find_paths_from_terminal(terminal_node, path_buffer, path_offsets, deadline);
+
+        for (size_t i = 0; i + 1 < path_offsets.size(); i++)
+        {
+            all_paths.insert(make_pair(unlabeled_path(path_buffer.begin() + path_offsets[i], path_buffer.begin() + path_offsets[i+1]), target_id));
+        }
 	}
     //cout << "find_all_path_rev finished with = " << all_paths.size() << " paths" <<  endl;
-    
+
     return all_paths;
 }
 
 
-// DFS from start_node, build path from right to left, looking at in-neighbors
+// DFS from terminal_node, build path from right to left, looking at in-neighbors
 // Note : if we encounter a terminal node different from the one starting the DFS, we exit
 //Any path that contains a terminal node in another positon than the last node of the path, is not output
 // Note2 : the strategy consisting in replacing the current path by the current node in such a case does not work because it prevents the detection of certain cycles...
-set<pair<unlabeled_path,bkpt_t>> GraphAnalysis::find_all_paths_rev(int start_node, set< info_node_t > terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success, int &terminal_node, bkpt_t &target_id)
+// The current path is the stack (from terminal_node at the bottom to the current node at the top), each node of the graph is used in a path at most once
+// (as a consequence, we won't gapfill some tandem repeats).
+// The search stops when a node has more than max_breadth paths below it (the paths found so far are kept), or after 10M visited nodes.
+bool GraphAnalysis::find_paths_from_terminal(int terminal_node, vector<int>& path_buffer, vector<size_t>& path_offsets, const FillDeadline* deadline)
 {
-    //cout << nb_calls << endl;
-
-    set<pair<unlabeled_path,bkpt_t>> paths;
-    // don't explore for too long
-    if (nb_calls++ > 10000000)
-    {
-       //cout <<"fail, max nb_calls reached" << endl;
+    int terminal_vertex = node_to_vertex(terminal_node);
+    int start_vertex = node_to_vertex(0);
+    int nb_calls = 0;
+    int nb_found = 0;
+    bool success = true;
 
-        success = false;
+    dfs_stack.clear();
 
-        return paths;
-    }
+    // visits vertex, returns false if it is not pushed on the stack (end of a path, or dead end)
+    int vertex = terminal_vertex;
+    for (;;)
+    {
+        bool pushed = false;
 
-    // is on another terminal_node, modify the current path to begin with this node
-    //note : must be before the condition "found_path" if node 0 is a terminal node
-    if (start_node != terminal_node){
-        for (set< info_node_t >::iterator it_targets = terminal_nodes_with_endpos.begin() ; it_targets != terminal_nodes_with_endpos.end() ; it_targets++)
+        // the clock is only read every 4096 nodes
+        if (deadline && (nb_calls & 4095) == 0 && deadline->expired())
         {
-            if (it_targets->node_id == start_node )
+            // the state of the search is reset before aborting the gap-filling
+            for (vector<dfs_frame_t>::iterator it = dfs_stack.begin(); it != dfs_stack.end(); ++it)
             {
-//            target_id = it_targets->targetId;
-//            current_path.clear();
-//            current_path.push_back(start_node);
-//            break;
-                return paths;
+                on_path[it->vertex] = false;
             }
+            dfs_stack.clear();
+            throw FillTimeoutException();
         }
-    }
 
-	//found a path
-	if (start_node ==0)
+        // don't explore for too long
+        if (nb_calls++ > 10000000)
         {
-            pair<unlabeled_path,bkpt_t> found_path = make_pair(current_path,target_id);
-            paths.insert(found_path);
-            
-           /*cout << "path=";
-           for(vector<int>::iterator it_path = current_path.begin(); it_path != current_path.end(); it_path++)
-            {        cout << *it_path << " ";
+            //cout <<"fail, max nb_calls reached" << endl;
+            success = false;
+        }
+        // is on another terminal_node
+        //note : must be before the condition "found_path" if node 0 is a terminal node
+        else if (vertex != terminal_vertex && is_terminal(vertex))
+        {
+        }
+        //found a path
+        else if (vertex == start_vertex)
+        {
+            path_buffer.push_back(0);
+            for (vector<dfs_frame_t>::reverse_iterator it = dfs_stack.rbegin(); it != dfs_stack.rend(); ++it)
+            {
+                path_buffer.push_back(vertex_to_node(it->vertex));
             }
-            cout << endl;*/
-            
-            return paths;
+            path_offsets.push_back(path_buffer.size());
+            nb_found++;
         }
-
-    // visit all neighbors
-    for(set<int>::iterator it_edge = in_edges[start_node].begin(); it_edge != in_edges[start_node].end(); it_edge++)
-    {
-        int next_node = *it_edge;
-
-        // each node of the graph is used in a path at most once (as a consequence, we won't gapfill some tandem repeats)
-        if (find(current_path.begin(), current_path.end(), next_node) == current_path.end())
+        else
         {
-            unlabeled_path extended_path(current_path);
-            extended_path.insert(extended_path.begin(),next_node);
-
-            // some debug
-            /*printf("calling with %d, curent path is:",next_node);
-            for(vector<int>::iterator it_path = current_path.begin(); it_path != current_path.end(); it_path++)
-                 printf(" %d",*it_path);
-            printf("\n");*/
-
-
-            // recursive call
-            set<pair<unlabeled_path,bkpt_t>> new_paths = find_all_paths_rev(next_node, terminal_nodes_with_endpos, extended_path, nb_calls, success, terminal_node, target_id);
-            paths.insert(new_paths.begin(), new_paths.end());
+            dfs_frame_t frame = {vertex, in_offsets[vertex], nb_found};
+            dfs_stack.push_back(frame);
+            on_path[vertex] = true;
+            pushed = true;
+        }
 
+        // next vertex to visit : the next in-neighbor not on the current path, going back up the stack when all the neighbors of the top node have been visited
+        bool returned = !pushed;
+        vertex = -1;
+        while (success && !dfs_stack.empty())
+        {
+            dfs_frame_t& top = dfs_stack.back();
 
-            // mark to stop we end up with too large breadth
-            if (paths.size() >= max_breadth)
+            // mark to stop we end up with too large breadth (checked when coming back from a neighbor)
+            if (returned && nb_found - top.nb_found_at_entry >= max_breadth)
             {
                 //printf("fail, max breadth reached \n");
                 success = false;
+                break;
+            }
+            returned = false;
+
+            if (top.next_edge == in_offsets[top.vertex+1])
+            {
+                on_path[top.vertex] = false;
+                dfs_stack.pop_back();
+                returned = true;
+                continue;
+            }
+
+            int next_vertex = in_neighbors[top.next_edge++];
+            if (!on_path[next_vertex])
+            {
+                vertex = next_vertex;
+                break;
             }
         }
 
-        // propagate the stop if too many consensuses reached
-        if (success == false)
-            return paths;
+        if (vertex < 0) break;
     }
-    return paths;
+
+    // the search may have been stopped with nodes still on the stack
+    for (vector<dfs_frame_t>::iterator it = dfs_stack.begin(); it != dfs_stack.end(); ++it)
+    {
+        on_path[it->vertex] = false;
+    }
+    dfs_stack.clear();
+
+    return success;
 }
 
 
 
 
-std::vector<filled_insertion_t> GraphAnalysis::paths_to_sequences(set<unlabeled_path> paths , set< info_node_t > terminal_nodes_with_endpos )
+std::vector<filled_insertion_t> GraphAnalysis::paths_to_sequences(const set<unlabeled_path>& paths , const set< info_node_t >& terminal_nodes_with_endpos )
 {
     //debug =2;
     std::vector<filled_insertion_t> sequences;
@@ -336,7 +469,7 @@ std::vector<filled_insertion_t> GraphAnalysis::paths_to_sequences(set<unlabeled_
     bkpt_t targetId_anchor;
 
     //printf("paths set size %i \n",paths.size());
-    for (set<unlabeled_path>::iterator it = paths.begin(); it != paths.end(); it++)
+    for (set<unlabeled_path>::const_iterator it = paths.begin(); it != paths.end(); it++)
     {
 //        if (debug)
 //            printf("processing path: \n");
@@ -366,7 +499,7 @@ std::vector<filled_insertion_t> GraphAnalysis::paths_to_sequences(set<unlabeled_
             if (revcomp)
                 node -= nb_nodes;
 
-            string node_sequence = node_sequences[node];
+            string node_sequence = this->node_sequence(node);
             //Mettre abondance
 
             if (revcomp)
@@ -387,7 +520,7 @@ std::vector<filled_insertion_t> GraphAnalysis::paths_to_sequences(set<unlabeled_
             {
                 set<int> terminal_nodes;
                 //retreive anchor pos
-                for (set< info_node_t >::iterator it = terminal_nodes_with_endpos.begin(); it != terminal_nodes_with_endpos.end(); it++)
+                for (set< info_node_t >::const_iterator it = terminal_nodes_with_endpos.begin(); it != terminal_nodes_with_endpos.end(); it++)
                 {
                     if((*it).node_id == node)
                     {
@@ -17,6 +17,10 @@
  *  You should have received a copy of the GNU Affero General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *****************************************************************************/
+
+#ifndef _TOOL_GraphAnalysis_HPP_
+#define _TOOL_GraphAnalysis_HPP_
+
 #include <string>
 
 
@@ -50,25 +54,77 @@ public:
     string node_identifier(int node);
     int revcomp_node(int node);
 
-    NS_TR1_PREFIX::unordered_map<int,string > node_sequences;
-    NS_TR1_PREFIX::unordered_map<int,set<int> > out_edges;
-    NS_TR1_PREFIX::unordered_map<int,set<int> > in_edges;
+    // the contig graph is stored in compressed sparse row format, on vertices 2n+strand for the node n (strand 0: forward, 1: revcomp)
+    // the out-neighbors of vertex v are out_neighbors[out_offsets[v]] .. out_neighbors[out_offsets[v+1]-1], sorted without duplicates (idem for in)
+    // Note: node ids outside of this class (paths, terminal nodes) keep the convention n for "nf" and n+nb_nodes for "nr"
+    vector<int> out_offsets;
+    vector<int> out_neighbors;
+    vector<int> in_offsets;
+    vector<int> in_neighbors;
+
+    // all node sequences, one after the other : node n is sequence_arena[sequence_offsets[n] .. sequence_offsets[n+1]-1]
+    string sequence_arena;
+    vector<size_t> sequence_offsets;
+
+    int node_to_vertex(int node) { return (node < nb_nodes) ? 2*node : 2*(node-nb_nodes)+1; }
+    int vertex_to_node(int vertex) { return (vertex & 1) ? (vertex >> 1) + nb_nodes : (vertex >> 1); }
+
+    string node_sequence(int node) { return sequence_arena.substr(sequence_offsets[node], sequence_offsets[node+1]-sequence_offsets[node]); }
 
 	size_t _sizeKmer;
 
 
     GraphAnalysis(string graph_file_name,size_t kmerSize);
+    GraphAnalysis(const contig_graph_t& contig_graph,size_t kmerSize);
+
+    // empty graph, to be filled by load() : the same object can be loaded again for each gap-filling, reusing its arrays
+    GraphAnalysis();
+    void load(const contig_graph_t& contig_graph,size_t kmerSize);
 
     
 
-    set<pair<unlabeled_path,bkpt_t>> find_all_paths(set<info_node_t> terminal_nodes_with_endpos, bool &success);
-    set<pair<unlabeled_path,bkpt_t>> find_all_paths(int start_node, set<info_node_t> terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success);
+    set<pair<unlabeled_path,bkpt_t>> find_all_paths(const set<info_node_t>& terminal_nodes_with_endpos, bool &success);
+    set<pair<unlabeled_path,bkpt_t>> find_all_paths(int start_node, const set<info_node_t>& terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success);
     
-    set<pair<unlabeled_path,bkpt_t>> find_all_paths_rev(set< info_node_t > terminal_nodes_with_endpos);
-	set<pair<unlabeled_path,bkpt_t>> find_all_paths_rev(int start_node, set< info_node_t > terminal_nodes_with_endpos, unlabeled_path current_path, int &nb_calls, bool &success, int &terminal_node, bkpt_t &target_id);
+    // if deadline is given, it is checked during the search (throws FillTimeoutException)
+    set<pair<unlabeled_path,bkpt_t>> find_all_paths_rev(const set< info_node_t >& terminal_nodes_with_endpos, const FillDeadline* deadline = NULL);
 
     
     static int debug; // 0: no debug, 1: node id debug, 2: ful sequence debug; useful to see the sequences of the traversed paths
-    std::vector<filled_insertion_t> paths_to_sequences(set<unlabeled_path> paths, set< info_node_t > terminal_nodes_with_endpos); 
+    std::vector<filled_insertion_t> paths_to_sequences(const set<unlabeled_path>& paths, const set< info_node_t >& terminal_nodes_with_endpos); 
+
+private:
+
+    // vertex v is one of the terminal nodes of the current search if terminal_epoch[v] == epoch :
+    // a new search only increments epoch instead of clearing the marks
+    vector<unsigned int> terminal_epoch;
+    unsigned int epoch;
+    bool is_terminal(int vertex) { return terminal_epoch[vertex] == epoch; }
+    void set_terminal_nodes(const set< info_node_t >& terminal_nodes_with_endpos);
+
+    // builds the CSR arrays from the list of edges (node_a,node_b) (with the outside node ids), sets nb_edges
+    void build_adjacency(vector<pair<int,int> >& edges);
+
+    // iterative DFS of find_all_paths_rev from one terminal node towards node 0
+    // the paths found are appended to path_buffer (node ids from 0 to terminal_node), path i is path_buffer[path_offsets[i] .. path_offsets[i+1]-1]
+    // returns false if the search was stopped by the max_breadth or nb_calls limits
+    bool find_paths_from_terminal(int terminal_node, vector<int>& path_buffer, vector<size_t>& path_offsets, const FillDeadline* deadline);
+
+    // state of the DFS, allocated once for all the searches
+    struct dfs_frame_t
+    {
+        int vertex;
+        int next_edge; // next in-edge of vertex to explore
+        int nb_found_at_entry; // number of paths found before entering vertex
+    };
+    vector<dfs_frame_t> dfs_stack;
+    vector<bool> on_path; // all false between two searches
+    vector<int> path_buffer;
+    vector<size_t> path_offsets;
+
+    // buffers of load and build_adjacency
+    vector<pair<int,int> > edge_buffer;
+    vector<int> in_fill;
 };
 
+#endif /* _TOOL_GraphAnalysis_HPP_ */
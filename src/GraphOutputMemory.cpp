@@ -0,0 +1,124 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen, C.Lemaitre
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <GraphOutputMemory.hpp>
+
+using namespace std;
+
+/*********************************************************************
+ ** METHOD  :
+ ** PURPOSE :
+ ** INPUT   :
+ ** OUTPUT  :
+ ** RETURN  :
+ ** REMARKS :
+ *********************************************************************/
+template<size_t span>
+GraphOutputMemory<span>::GraphOutputMemory (size_t kmerSize, contig_graph_t& graph)
+    : IGraphOutput<span> (kmerSize,""), _graph(graph)
+{
+    _graph.node_sequences.clear();
+    _graph.edges.clear();
+}
+
+template<size_t span>
+void GraphOutputMemory<span>::clear()
+{
+    this->reset();
+    _graph.node_sequences.clear();
+    _graph.edges.clear();
+}
+
+/*********************************************************************
+ ** METHOD  :
+ ** PURPOSE : nothing to flush, the graph is already complete
+ ** INPUT   :
+ ** OUTPUT  :
+ ** RETURN  :
+ ** REMARKS :
+ *********************************************************************/
+template<size_t span>
+void GraphOutputMemory<span>::close()
+{
+
+}
+
+template<size_t span>
+void GraphOutputMemory<span>::print_starter_head (int index, char* sequence, size_t sequenceLen)
+{
+
+}
+
+template<size_t span>
+void GraphOutputMemory<span>::print_starter_end()
+{
+
+}
+
+template<size_t span>
+void GraphOutputMemory<span>::print_sequence_head (const string& linear_seqs_name, const string& direction)
+{
+
+}
+
+template<size_t span>
+void GraphOutputMemory<span>::print_sequence_end ()
+{
+
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : add a single node to the graph
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS : nodes are printed with strictly incremental ids (0,1,2...)
+*********************************************************************/
+template<size_t span>
+void GraphOutputMemory<span>::print_node (long index, const string& seq)
+{
+    _graph.node_sequences.push_back(seq);
+}
+
+/*********************************************************************
+** METHOD  :
+** PURPOSE : add a single edge to the graph
+** INPUT   :
+** OUTPUT  :
+** RETURN  :
+** REMARKS :
+*********************************************************************/
+template<size_t span>
+void GraphOutputMemory<span>::print_edge (long index, long id, long id2, const string& label, const string& comment)
+{
+    contig_edge_t edge;
+    edge.from = id;
+    edge.to = id2;
+    edge.label = label;
+    _graph.edges.push_back(edge);
+}
+
+// WARNING !!! The following code is not generic !!!
+// It is designed to cope with 4 values of supported kmer size.
+
+template class GraphOutputMemory <KMER_SPAN(0)>;
+template class GraphOutputMemory <KMER_SPAN(1)>;
+template class GraphOutputMemory <KMER_SPAN(2)>;
+template class GraphOutputMemory <KMER_SPAN(3)>;
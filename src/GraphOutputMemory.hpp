@@ -0,0 +1,77 @@
+/*****************************************************************************
+ *   GATB : Genome Assembly Tool Box
+ *   Copyright (C) 2014  INRIA
+ *   Authors: R.Chikhi, G.Rizk, E.Drezen, C.Lemaitre
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _GRAPHOUTPUTMEMORY_H
+#define _GRAPHOUTPUTMEMORY_H
+
+/********************************************************************************/
+#include <IGraphOutput.hpp>
+/********************************************************************************/
+
+//edge of a contig graph kept in memory
+struct contig_edge_t
+{
+    long from;
+    long to;
+    std::string label; // strands of the overlap, as in the dot file (FF, FR, RF or RR)
+};
+
+//contig graph kept in memory : the same content as the dot file, without going through the disk
+struct contig_graph_t
+{
+    std::vector<std::string> node_sequences; // indexed by node id
+    std::vector<contig_edge_t> edges;
+};
+
+/********************************************************************************/
+
+template<size_t span>
+class GraphOutputMemory : public IGraphOutput<span>
+{
+public:
+
+    /** Constructor.
+     * \param[in] kmerSize : size of the kmer
+     * \param[in] graph : the graph to fill
+     * */
+    GraphOutputMemory (size_t kmerSize, contig_graph_t& graph);
+
+    /** Empties the graph and restarts the ids from 0, to build the graph of another gap-filling with the same object. */
+    void clear();
+
+    /** Finish the output. */
+    virtual void close();
+
+    virtual void print_starter_head (int index, char* sequence, size_t sequenceLen);
+    virtual void print_starter_end  ();
+
+    virtual void print_sequence_head (const std::string& filename, const std::string& direction);
+    virtual void print_sequence_end  ();
+
+    virtual void print_node (long index, const std::string& seq);
+    virtual void print_edge (long index, long id, long id2, const std::string& label, const std::string& comment);
+
+private:
+
+    contig_graph_t& _graph;
+};
+
+/********************************************************************************/
+
+#endif //_GRAPHOUTPUTMEMORY_H
@@ -0,0 +1,258 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <HammingKernel.hpp>
+#include <Utils.hpp>
+#include <string.h>
+
+// null words after the end of the planes, for the shifted loads of the widest kernel (4 words + 1)
+#define PACKED_PADDING 5
+
+// bit-sliced counters of the all windows kernel, larger numbers of mismatches use the scalar comparison
+#define MAX_KERNEL_MIS 15
+
+packed_seq_t::packed_seq_t(const char* seq, size_t len) : length(len), nb_invalid(0)
+{
+    size_t nb_words = (len + 63) / 64 + PACKED_PADDING;
+    lo.assign(nb_words, 0);
+    hi.assign(nb_words, 0);
+    invalid.assign(nb_words, 0);
+
+    for (size_t j = 0; j < len; j++)
+    {
+        uint64_t bit = 1ULL << (j & 63);
+        switch (seq[j])
+        {
+            case 'A': case 'a': break;
+            case 'C': case 'c': lo[j >> 6] |= bit; break;
+            case 'G': case 'g': hi[j >> 6] |= bit; break;
+            case 'T': case 't': lo[j >> 6] |= bit; hi[j >> 6] |= bit; break;
+            default: invalid[j >> 6] |= bit; nb_invalid++; break;
+        }
+    }
+}
+
+// the 64 bits of the plane starting at bit p
+static inline uint64_t extract_word(const vector<uint64_t>& plane, size_t p)
+{
+    size_t q = p >> 6;
+    int r = p & 63;
+    if (r == 0) return plane[q];
+    return (plane[q] >> r) | (plane[q+1] << (64 - r));
+}
+
+static int identNT_mismatches(const char* seq, const char* anchor, size_t size, int max_mis)
+{
+    int nbmis = 0;
+    for (size_t i = 0; i < size && nbmis <= max_mis; i++)
+    {
+        nbmis += 1 - identNT(seq[i], anchor[i]);
+    }
+    return nbmis > max_mis ? max_mis + 1 : nbmis;
+}
+
+int window_mismatches(const packed_seq_t& seq, const char* seq_chars, size_t j, const packed_seq_t& anchor, const char* anchor_chars, int max_mis)
+{
+    int nbmis = 0;
+    for (size_t i = 0; i < anchor.length && nbmis <= max_mis; i += 64)
+    {
+        uint64_t mask = (anchor.length - i >= 64) ? ~0ULL : (1ULL << (anchor.length - i)) - 1;
+        uint64_t inv = (extract_word(seq.invalid, j + i) | anchor.invalid[i >> 6]) & mask;
+        if (inv)
+        {
+            // non ACGT characters may still be identical for identNT
+            return identNT_mismatches(seq_chars + j, anchor_chars, anchor.length, max_mis);
+        }
+        uint64_t diff = (extract_word(seq.lo, j + i) ^ anchor.lo[i >> 6]) | (extract_word(seq.hi, j + i) ^ anchor.hi[i >> 6]);
+        nbmis += __builtin_popcountll(diff & mask);
+    }
+    return nbmis > max_mis ? max_mis + 1 : nbmis;
+}
+
+/********************************************************************************/
+/*                      all windows, bit-sliced counters                         */
+/********************************************************************************/
+
+// The same template code is inlined in the scalar, SSE4.2 and AVX2 functions, V is a block of 64, 128 or 256 windows
+// (one bit per window), the vector types are GCC/clang vector extensions.
+typedef uint64_t v2u64_t __attribute__ ((vector_size (16)));
+typedef uint64_t v4u64_t __attribute__ ((vector_size (32)));
+
+// the vectors are passed by reference : these functions are only inlined in the target specific kernels
+template<typename V> static inline __attribute__((always_inline)) void load_block(V& v, const uint64_t* p)
+{
+    memcpy(&v, p, sizeof(V));
+}
+
+// bits [p, p + 64*nb_words) of the plane
+template<typename V> static inline __attribute__((always_inline)) void extract_block(V& v, const uint64_t* plane, size_t p)
+{
+    const uint64_t* words = plane + (p >> 6);
+    int r = p & 63;
+    load_block(v, words);
+    if (r == 0) return;
+
+    V next;
+    load_block(next, words + 1);
+    v = (v >> r) | (next << (64 - r));
+}
+
+template<typename V> static inline __attribute__((always_inline))
+void kernel_blocks(const packed_seq_t& seq, const packed_seq_t& anchor, int max_mis, vector<int>& mis)
+{
+    const int nb_lanes = sizeof(V) / sizeof(uint64_t);
+    const size_t block_size = 64 * nb_lanes;
+    size_t nb_windows = seq.length - anchor.length + 1;
+
+    // ge[l] : the window has at least l+1 mismatches
+    V ge[MAX_KERNEL_MIS + 1];
+    uint64_t lanes[MAX_KERNEL_MIS + 1][nb_lanes];
+
+    for (size_t j0 = 0; j0 < nb_windows; j0 += block_size)
+    {
+        memset(ge, 0, sizeof(ge));
+
+        for (size_t i = 0; i < anchor.length; i++)
+        {
+            uint64_t a_lo = - ((anchor.lo[i >> 6] >> (i & 63)) & 1ULL);
+            uint64_t a_hi = - ((anchor.hi[i >> 6] >> (i & 63)) & 1ULL);
+
+            V x, y;
+            extract_block(x, &seq.lo[0], j0 + i);
+            extract_block(y, &seq.hi[0], j0 + i);
+            x = (x ^ a_lo) | (y ^ a_hi);
+            if (seq.nb_invalid)
+            {
+                extract_block(y, &seq.invalid[0], j0 + i);
+                x = x | y;
+            }
+
+            for (int l = max_mis; l > 0; l--) ge[l] = ge[l] | (ge[l-1] & x);
+            ge[0] = ge[0] | x;
+
+            // stops when all the windows of the block have too many mismatches
+            if ((i & 7) == 7)
+            {
+                memcpy(lanes[max_mis], &ge[max_mis], sizeof(V));
+                bool all_above = true;
+                for (int k = 0; k < nb_lanes && all_above; k++)
+                {
+                    size_t first = j0 + 64 * k;
+                    if (first >= nb_windows) break;
+                    uint64_t valid = (nb_windows - first >= 64) ? ~0ULL : (1ULL << (nb_windows - first)) - 1;
+                    all_above = (~lanes[max_mis][k] & valid) == 0;
+                }
+                if (all_above) break;
+            }
+        }
+
+        for (int l = 0; l <= max_mis; l++) memcpy(lanes[l], &ge[l], sizeof(V));
+
+        for (size_t w = 0; w < block_size && j0 + w < nb_windows; w++)
+        {
+            int count = 0;
+            while (count <= max_mis && ((lanes[count][w >> 6] >> (w & 63)) & 1ULL)) count++;
+            mis[j0 + w] = count;
+        }
+    }
+}
+
+static void kernel_scalar(const packed_seq_t& seq, const packed_seq_t& anchor, int max_mis, vector<int>& mis)
+{
+    kernel_blocks<uint64_t>(seq, anchor, max_mis, mis);
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAMMING_KERNEL_X86
+
+__attribute__((target("sse4.2")))
+static void kernel_sse42(const packed_seq_t& seq, const packed_seq_t& anchor, int max_mis, vector<int>& mis)
+{
+    kernel_blocks<v2u64_t>(seq, anchor, max_mis, mis);
+}
+
+__attribute__((target("avx2")))
+static void kernel_avx2(const packed_seq_t& seq, const packed_seq_t& anchor, int max_mis, vector<int>& mis)
+{
+    kernel_blocks<v4u64_t>(seq, anchor, max_mis, mis);
+}
+#endif
+
+typedef void (*hamming_kernel_t)(const packed_seq_t&, const packed_seq_t&, int, vector<int>&);
+
+static hamming_kernel_t select_kernel(const char** name)
+{
+#ifdef HAMMING_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))   { *name = "avx2";   return kernel_avx2; }
+    if (__builtin_cpu_supports("sse4.2")) { *name = "sse4.2"; return kernel_sse42; }
+#endif
+    *name = "scalar";
+    return kernel_scalar;
+}
+
+static const char* kernel_name = 0;
+static const hamming_kernel_t kernel = select_kernel(&kernel_name);
+
+const char* hamming_kernel_name()
+{
+    return kernel_name;
+}
+
+void all_windows_mismatches(const packed_seq_t& seq, const char* seq_chars, const packed_seq_t& anchor, const char* anchor_chars, int max_mis, vector<int>& mis)
+{
+    mis.clear();
+    if (seq.length < anchor.length) return;
+
+    size_t nb_windows = seq.length - anchor.length + 1;
+    mis.resize(nb_windows);
+
+    if (anchor.nb_invalid || max_mis > MAX_KERNEL_MIS || max_mis >= (int) anchor.length)
+    {
+        for (size_t j = 0; j < nb_windows; j++)
+        {
+            mis[j] = identNT_mismatches(seq_chars + j, anchor_chars, anchor.length, max_mis);
+        }
+        return;
+    }
+
+    kernel(seq, anchor, max_mis, mis);
+
+    // the kernel counts the non ACGT characters of the sequence as mismatches, the windows containing them are compared with identNT
+    if (seq.nb_invalid)
+    {
+        size_t last_invalid = 0;
+        bool found = false;
+        for (size_t j = 0; j < seq.length; j++)
+        {
+            if ((seq.invalid[j >> 6] >> (j & 63)) & 1ULL)
+            {
+                size_t first = (j + 1 >= anchor.length) ? j + 1 - anchor.length : 0;
+                if (found && first <= last_invalid) first = last_invalid + 1;
+                for (size_t w = first; w <= j && w < nb_windows; w++)
+                {
+                    mis[w] = identNT_mismatches(seq_chars + w, anchor_chars, anchor.length, max_mis);
+                }
+                last_invalid = j;
+                found = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _HammingKernel_HPP_
+#define _HammingKernel_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * 2-bit packed form of a nucleotide sequence, stored as bit planes : bit j of each plane is for the nucleotide j.
+ * A,C,G,T (upper or lower case) are coded 0,1,2,3 (lo and hi planes), any other character is flagged in the invalid plane (code 0).
+ * The planes are padded with null words so that the kernels can read a few words past the end.
+ */
+class packed_seq_t
+{
+public:
+
+    packed_seq_t(const char* seq, size_t len);
+
+    size_t length;
+    vector<uint64_t> lo;
+    vector<uint64_t> hi;
+    vector<uint64_t> invalid;
+    int nb_invalid;
+};
+
+/**
+ * Number of mismatches between the anchor and the window of the sequence starting at position j (XOR/popcount on the packed forms).
+ * Same count as identNT (positions with a non ACGT character are compared with identNT), returns max_mis+1 if there are more than max_mis mismatches.
+ * seq and anchor_seq are the sequences that were packed.
+ */
+int window_mismatches(const packed_seq_t& seq, const char* seq_chars, size_t j, const packed_seq_t& anchor, const char* anchor_chars, int max_mis);
+
+/**
+ * Number of mismatches between the anchor and every window of the sequence : mis[j] for the window starting at j, capped at max_mis+1.
+ * The windows are processed 64, 128 (SSE4.2) or 256 (AVX2) at once with bit-sliced counters, the code path is chosen at runtime.
+ * Same count as identNT.
+ */
+void all_windows_mismatches(const packed_seq_t& seq, const char* seq_chars, const packed_seq_t& anchor, const char* anchor_chars, int max_mis, vector<int>& mis);
+
+/**
+ * Name of the code path used by all_windows_mismatches ("avx2", "sse4.2" or "scalar")
+ */
+const char* hamming_kernel_name();
+
+#endif /* _HammingKernel_HPP_ */
@@ -51,22 +51,18 @@ IGraphOutput<span>::IGraphOutput (size_t kmerSize, const string& prefix)
 ** REMARKS :
 *********************************************************************/
 template<size_t span>
-void IGraphOutput<span>::load_nodes_extremities (const string& linear_seqs_name,std::string & infostring)
+void IGraphOutput<span>::load_nodes_extremities (const std::vector<std::string>& linear_seqs,std::string & infostring)
 {
     kmer_links.clear();
 
-    /** We open the bank that holds the extensions. */
-    IBank* Nodes = Bank::open (linear_seqs_name);    LOCAL (Nodes);
-
     long nb_nodes = first_id_els.node;
 	long totalnt =0;
-    DEBUG (("[GraphOutput::load_nodes_extremities]  kmerSize=%ld  name=%s\n", _modelKmerMinusOne.getKmerSize(), linear_seqs_name.c_str()));
+    DEBUG (("[GraphOutput::load_nodes_extremities]  kmerSize=%ld  nbSeqs=%ld\n", _modelKmerMinusOne.getKmerSize(), linear_seqs.size()));
 
-    Iterator<Sequence>* itSeq = Nodes->iterator();   LOCAL (itSeq);
-    for (itSeq->first(); !itSeq->isDone(); itSeq->next())
+    for (std::vector<std::string>::const_iterator itSeq = linear_seqs.begin(); itSeq != linear_seqs.end(); itSeq++)
     {
-        char* rseq    = itSeq->item().getDataBuffer();
-        int   readlen = itSeq->item().getDataSize();
+        const char* rseq    = itSeq->c_str();
+        int   readlen = itSeq->size();
 		totalnt  += readlen;
         DEBUG (("[GraphOutput::load_nodes_extremities]  seq.size=%ld\n", readlen));
 
@@ -94,25 +90,20 @@ void IGraphOutput<span>::load_nodes_extremities (const string& linear_seqs_name,
 ** REMARKS :
 *********************************************************************/
 template<size_t span>
-id_els IGraphOutput<span>::construct_graph (const string& linear_seqs_name, const string& direction)
+id_els IGraphOutput<span>::construct_graph (const std::vector<std::string>& linear_seqs, const string& direction, const FillDeadline* deadline)
 {
-    DEBUG (("[GraphOutput::construct_graph]  linear_seqs_name=%s   direction=%s\n", linear_seqs_name.c_str(), direction.c_str() ));
-
-    /** We open the bank that holds the extensions. */
-    IBank* Nodes = Bank::open (linear_seqs_name);    LOCAL (Nodes);
+    DEBUG (("[GraphOutput::construct_graph]  nbSeqs=%ld   direction=%s\n", linear_seqs.size(), direction.c_str() ));
 
     id_els nb_els = first_id_els;
     bool found = false;
 
-    print_sequence_head (linear_seqs_name, direction);
+    print_sequence_head ("", direction);
 
-    Iterator<Sequence>* itSeq = Nodes->iterator();   LOCAL (itSeq);
-    for (itSeq->first(); !itSeq->isDone(); itSeq->next())
+    for (std::vector<std::string>::const_iterator itSeq = linear_seqs.begin(); itSeq != linear_seqs.end(); itSeq++)
     {
-        /** We get the current sequence as a string object.
-         * NOTE: we can't rely on strlen() on itSeq->item().getDataBuffer() because the buffer may be not
-         * 0 terminated (it's just a buffer, not a C-like string). */
-        string seq;  seq.assign (itSeq->item().getDataBuffer(), itSeq->item().getDataSize());
+        const string& seq = *itSeq;
+
+        if (deadline)  { deadline->check(); }
 
         ModelKmer leftKmer  = _modelKmerMinusOne.codeSeed (seq.c_str(), Data::ASCII, 0);
         ModelKmer rightKmer = _modelKmerMinusOne.codeSeed (seq.c_str(), Data::ASCII, seq.size()-_modelKmerMinusOne.getKmerSize());
@@ -125,7 +116,7 @@ id_els IGraphOutput<span>::construct_graph (const string& linear_seqs_name, cons
 
         found = true ;
 
-    } /* end of for (itSeq->first(); !itSeq->isDone(); itSeq->next()) */
+    } /* end of for (itSeq = linear_seqs.begin(); ...) */
 
     if (found)  {  print_sequence_end ();  }
 
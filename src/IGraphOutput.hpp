@@ -22,6 +22,7 @@
 
 /********************************************************************************/
 #include <gatb/gatb_core.hpp>
+#include <FillDeadline.hpp>
 /********************************************************************************/
 
     #include <unordered_map>
@@ -92,11 +93,11 @@ public:
     /** Destructor. */
     virtual ~IGraphOutput() {}
 
-    /** */
-    void load_nodes_extremities (const std::string& linear_seqs_name,std::string & infostring);
+    /** \param[in] linear_seqs : the linear sequences (nodes of the graph), as built by IterativeExtensions */
+    void load_nodes_extremities (const std::vector<std::string>& linear_seqs,std::string & infostring);
 
-    /** */
-    id_els construct_graph (const std::string& linear_seqs_name, const std::string& direction);
+    /** \param[in] deadline : if given, checked for each node (throws FillTimeoutException) */
+    id_els construct_graph (const std::vector<std::string>& linear_seqs, const std::string& direction, const FillDeadline* deadline = NULL);
 
     /** Finish the output. */
     virtual void close() = 0;
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "Indexer.hpp"
+#include <FindBreakpoints.hpp>
+
+using namespace std;
+
+/********************************************************************************/
+
+Indexer::~Indexer()
+{
+    if(_refBank != 0) {_refBank->forget();}
+}
+
+void HelpIndexer(void* target)
+{
+	if(target!=NULL)
+	{
+		Indexer * obj = (Indexer *) target;
+		obj->IndexerHelp();
+	}
+}
+
+/*********************************************************************
+ ** METHOD  :
+ ** PURPOSE :
+ ** INPUT   :
+ ** OUTPUT  :
+ ** RETURN  :
+ ** REMARKS :
+ *********************************************************************/
+Indexer::Indexer ()  : Tool ("MindTheGap index")
+{
+    _refBank = 0;
+    _kmerSize = 31;
+    _het_max_occ = 1;
+
+	setHelp(&HelpIndexer);
+	setHelpTarget(this);
+
+    // Option parser, with several sub-parsers
+    setParser (new OptionsParser ("MindTheGap index"));
+
+    IOptionsParser* generalParser = new OptionsParser("General");
+    generalParser->push_front (new OptionOneParam (STR_VERBOSE,     "verbosity level",      false, "1"  ));
+    generalParser->push_front (new OptionOneParam (STR_NB_CORES,    "number of cores",      false, "0"  ));
+
+    IOptionsParser* inputParser = new OptionsParser("Input / output");
+    inputParser->push_front (new OptionOneParam (STR_URI_OUTPUT, "prefix for output files (default: the reference file name)", false, ""));
+    inputParser->push_front (new OptionOneParam (STR_URI_REF, "reference genome file", false,""));
+
+    // the parameters of the repeat Bloom, they must be the ones of the find runs using the index
+    IOptionsParser* indexParser = new OptionsParser("Index");
+    indexParser->push_front (new OptionOneParam (STR_HET_MAX_OCC, "maximal number of occurrences of a kmer in the reference genome allowed for heterozyguous breakpoints", false,"1"));
+    indexParser->push_front (new OptionOneParam (STR_KMER_SIZE, "size of a kmer (the one of the graph)", false, "31"));
+
+    getParser()->push_front(generalParser);
+    getParser()->push_front(indexParser);
+    getParser()->push_front(inputParser);
+}
+
+void Indexer::IndexerHelp()
+{
+	cout << endl << "Usage:  MindTheGap index -ref <reference.fa> [options]" << endl;
+	OptionsHelpVisitor v(cout);
+	getParser()->accept(v);
+	throw Exception(); // to get out with EXIT_FAILURE
+}
+
+/*********************************************************************
+ ** METHOD  :
+ ** PURPOSE :
+ ** INPUT   :
+ ** OUTPUT  :
+ ** RETURN  :
+ ** REMARKS :
+ *********************************************************************/
+void Indexer::execute ()
+{
+    if (getInput()->get(STR_URI_REF) == 0){
+    	throw OptionFailure(getParser(), "ERROR: option -ref is mandatory");
+    }
+    _ref_file_name = getInput()->getStr(STR_URI_REF);
+
+    if (getInput()->get(STR_URI_OUTPUT) == 0 || getInput()->getStr(STR_URI_OUTPUT) == "")
+    {
+        getInput()->add (0, STR_URI_OUTPUT, _ref_file_name);
+    }
+    _index_file_name = getInput()->getStr(STR_URI_OUTPUT) + STR_REF_INDEX_EXTENSION;
+
+    _kmerSize = getInput()->getInt(STR_KMER_SIZE);
+    _het_max_occ = getInput()->getInt(STR_HET_MAX_OCC);
+    if(_het_max_occ<1){
+    	_het_max_occ=1;
+    }
+
+    _refBank = Bank::open(_ref_file_name);
+    _refBank->use();
+
+    time_t start_time = time(0);
+    // According to the kmer size, we call one runIndex method.
+    Integer::apply<runIndex,Indexer*> (_kmerSize, this);
+    time_t end_time = time(0);
+    double seconds=difftime(end_time,start_time);
+
+    resumeParameters();
+    resumeResults(seconds);
+}
+
+void Indexer::resumeParameters(){
+
+    getInfo()->add(0,"MindTheGap index");
+    getInfo()->add(1,"version",_mtg_version);
+    getInfo()->add(1,"gatb-core-library",System::info().getVersion().c_str());
+    getInfo()->add(1,"supported_kmer_sizes","%s", KSIZE_STRING);
+
+    getInfo()->add(0,"Parameters");
+    getInfo()->add(1,"Reference",_ref_file_name.c_str());
+    getInfo()->add(1,"kmer-size","%i", _kmerSize);
+    getInfo()->add(1,"hetero_max_occ","%i", _het_max_occ);
+}
+
+void Indexer::resumeResults(double seconds){
+    getInfo()->add(0,"Results");
+    getInfo()->add(1,"Time", "%.1f s",seconds);
+    getInfo()->add(1,"Output files");
+    getInfo()->add(2,"index_file","%s",_index_file_name.c_str());
+}
+
+template<size_t span>
+void Indexer::runIndex<span>::operator ()  (Indexer* object)
+{
+	typedef typename FindBreakpoints<span>::KmerType KmerType;
+
+	u_int64_t bloom_bit_size = 0;
+	size_t bloom_nb_hash = 0;
+	IBloom<KmerType>* ref_bloom = FindBreakpoints<span>::fillRefBloom(object, object->_refBank, object->_kmerSize, object->_het_max_occ, &bloom_bit_size, &bloom_nb_hash);
+	LOCAL(ref_bloom);
+
+	RefIndex::write(object->_index_file_name, object->_refBank, object->_ref_file_name, object->_kmerSize, object->_het_max_occ,
+		ref_bloom->getArray(), ref_bloom->getSize(), bloom_bit_size, bloom_nb_hash);
+}
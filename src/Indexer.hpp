@@ -0,0 +1,74 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _TOOL_Indexer_HPP_
+#define _TOOL_Indexer_HPP_
+
+/********************************************************************************/
+#include <gatb/gatb_core.hpp>
+#include <RefIndex.hpp>
+using namespace std;
+
+/********************************************************************************/
+
+static const char* STR_REF_INDEX_EXTENSION = ".ref-index";
+
+/** MindTheGap index : prepares a reference genome once for the find runs of several samples (option -ref-index of find)
+ */
+class Indexer : public Tool
+{
+public:
+
+    // Constructor
+    Indexer ();
+    ~Indexer ();
+
+    void IndexerHelp();
+
+    const char* _mtg_version;
+    size_t _kmerSize;
+    int _het_max_occ;
+    IBank* _refBank;
+    string _ref_file_name;
+    string _index_file_name;
+
+    // Actual job done by the tool is here
+    void execute ();
+
+private:
+
+    /** fills getInfo() with parameters informations
+     */
+    void resumeParameters();
+
+    /** fills getInfo() with results informations
+     * arg seconds running time
+     */
+    void resumeResults(double seconds);
+
+    /** Builds the repeat Bloom and writes the index
+     */
+    template<size_t span>
+    struct runIndex {  void operator ()  (Indexer* object); };
+};
+
+/********************************************************************************/
+
+#endif /* _TOOL_Indexer_HPP_ */
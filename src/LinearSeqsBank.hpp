@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _TOOL_LinearSeqsBank_HPP_
+#define _TOOL_LinearSeqsBank_HPP_
+
+/********************************************************************************/
+#include <gatb/gatb_core.hpp>
+#include <FillDeadline.hpp>
+#include <AnchorIndex.hpp>
+#include <string>
+#include <vector>
+/********************************************************************************/
+
+/**
+ * Thrown by LinearSeqsBank::insert to stop the extension once the target of the gap-filling was found (see LinearSeqsBank::watch_target)
+ */
+class FillTargetReachedException : public Exception
+{
+public:
+    FillTargetReachedException () : Exception ("target of the gap-filling reached") {}
+};
+
+/**
+ * \brief Bank receiving the linear sequences built by IterativeExtensions::construct_linear_seqs
+ *
+ * The sequences are only kept in memory, in their insertion order, to avoid writing and reading back a temporary fasta file for each gap.
+ * This bank can only be written : use sequences() to read its content.
+ * If a deadline is given, it is checked at each insertion : this stops the extension of a gap-filling that takes too long (FillTimeoutException).
+ * If a target is watched, the inserted sequences are searched for it : this stops the extension once it was found (FillTargetReachedException).
+ */
+class LinearSeqsBank : public AbstractBank
+{
+public:
+
+    LinearSeqsBank (const FillDeadline* deadline = NULL) : _totalSize(0), _deadline(deadline), _targetIndex(NULL) {}
+
+    std::string getId ()  { return "linear_seqs"; }
+
+    /** Not supported, use sequences() */
+    Iterator<Sequence>* iterator ()  { throw Exception ("LinearSeqsBank::iterator not supported"); }
+
+    int64_t getNbItems ()  { return _sequences.size(); }
+
+    void insert (const Sequence& item)
+    {
+        if (_deadline)  { _deadline->check(); }
+
+        _sequences.push_back (std::string (item.getDataBuffer(), item.getDataSize()));
+        _totalSize += item.getDataSize();
+
+        if (_targetIndex)  { check_target (_sequences.back()); }
+    }
+
+    void flush ()  {}
+
+    u_int64_t getSize ()  { return _totalSize; }
+
+    void estimate (u_int64_t& number, u_int64_t& totalSize, u_int64_t& maxSize)
+    {
+        number = _sequences.size();
+        totalSize = _totalSize;
+        maxSize = 0;
+        for (size_t i=0; i<_sequences.size(); i++)  { maxSize = std::max (maxSize, (u_int64_t) _sequences[i].size()); }
+    }
+
+    void remove ()  { _sequences.clear(); _totalSize = 0; }
+
+    /** Empties the bank for the next gap-filling, with its own deadline (and no watched target) */
+    void reset (const FillDeadline* deadline)  { remove(); _deadline = deadline; _targetIndex = NULL; }
+
+    /** Watches the target of the gap-filling (with at most nb_mis_allowed mismatches, excluded_target is ignored as in AnchorIndex::find_best_anchor) :
+     * the extension is stopped when nb_more_seqs sequences were inserted after the first one containing the target.
+     * As the extension is breadth-first, these are the sequences of about the same depth, which may give alternative fillings.
+     */
+    void watch_target (const AnchorIndex* targetIndex, int nb_mis_allowed, const std::string* excluded_target, int nb_more_seqs)
+    {
+        _targetIndex = targetIndex;
+        _nb_mis_allowed = nb_mis_allowed;
+        _excluded_target = excluded_target;
+        _nb_more_seqs = nb_more_seqs;
+        _nb_after_target = -1;
+    }
+
+    /** The linear sequences, in the order they were built (= node ids of the contig graph) */
+    const std::vector<std::string>& sequences ()  { return _sequences; }
+
+private:
+
+    void check_target (const std::string& seq)
+    {
+        if (_nb_after_target >= 0)
+        {
+            if (++_nb_after_target >= _nb_more_seqs)  { throw FillTargetReachedException(); }
+            return;
+        }
+
+        int position = 0;
+        int nb_match = 0;
+        bkpt_t target_id;
+        if (seq.size() >= _targetIndex->anchor_size()
+            && _targetIndex->find_best_anchor (seq.c_str(), seq.size(), _nb_mis_allowed, position, nb_match, target_id, _excluded_target))
+        {
+            _nb_after_target = 0;
+        }
+    }
+
+    std::vector<std::string> _sequences;
+    u_int64_t _totalSize;
+    const FillDeadline* _deadline;
+
+    const AnchorIndex* _targetIndex; // NULL : no watched target
+    int _nb_mis_allowed;
+    const std::string* _excluded_target;
+    int _nb_more_seqs;
+    int _nb_after_target; // -1 : target not found yet
+};
+
+/********************************************************************************/
+
+#endif /* _TOOL_LinearSeqsBank_HPP_ */
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _OrderedFillOutput_HPP_
+#define _OrderedFillOutput_HPP_
+
+#include <gatb/gatb_core.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * What a gap-filling writes in each output file (see Filler::writeFilledBreakpoint, writeVcf and writeToGFA)
+ */
+struct fill_output_t
+{
+    std::string insertions;
+    std::string info;
+    std::string vcf;
+    std::string gfa;
+};
+
+/**
+ * Writes the outputs of the gap-fillings in the order of the input breakpoints or seeds, whatever the order they are done in by the threads :
+ * the output of a gap-filling is kept until the ones of all the previous gap-fillings are written.
+ */
+class OrderedFillOutput
+{
+public:
+
+    /** the files may be NULL (vcf in contig mode, gfa in breakpoint mode) */
+    OrderedFillOutput (size_t nb_items, FILE* insert_file, FILE* info_file, FILE* vcf_file, FILE* gfa_file)
+        : _outputs(nb_items), _done(nb_items, false), _next(0),
+          _insert_file(insert_file), _info_file(info_file), _vcf_file(vcf_file), _gfa_file(gfa_file),
+          _synchro(System::thread().newSynchronizer())  {}
+
+    ~OrderedFillOutput ()  { delete _synchro; }
+
+    /** the output of the gap-filling of rank index in the input, its content is moved */
+    void submit (size_t index, fill_output_t& output)
+    {
+        LocalSynchronizer local (_synchro);
+
+        _outputs[index].insertions.swap (output.insertions);
+        _outputs[index].info.swap (output.info);
+        _outputs[index].vcf.swap (output.vcf);
+        _outputs[index].gfa.swap (output.gfa);
+        _done[index] = true;
+
+        for ( ; _next < _outputs.size() && _done[_next]; _next++)
+        {
+            fill_output_t& next = _outputs[_next];
+            write (_insert_file, next.insertions);
+            write (_info_file,   next.info);
+            write (_vcf_file,    next.vcf);
+            write (_gfa_file,    next.gfa);
+            next = fill_output_t();
+        }
+    }
+
+private:
+
+    static void write (FILE* file, const std::string& text)
+    {
+        if (file && !text.empty())  { fwrite (text.data(), 1, text.size(), file); }
+    }
+
+    std::vector<fill_output_t> _outputs;
+    std::vector<bool> _done;
+    size_t _next; // all the outputs before it are written
+
+    FILE* _insert_file;
+    FILE* _info_file;
+    FILE* _vcf_file;
+    FILE* _gfa_file;
+
+    ISynchronizer* _synchro;
+
+    OrderedFillOutput (const OrderedFillOutput&);
+    OrderedFillOutput& operator= (const OrderedFillOutput&);
+};
+
+#endif /* _OrderedFillOutput_HPP_ */
@@ -0,0 +1,299 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <RefIndex.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cctype>
+
+static const char REF_INDEX_MAGIC[8] = {'M','T','G','R','E','F','I','X'};
+static const uint64_t REF_INDEX_VERSION = 1;
+
+/** Sequential writer of the index file, keeping every block 8-byte aligned
+ */
+class ref_index_writer_t
+{
+public:
+    ref_index_writer_t(const string& file_name) : _file_name(file_name), _offset(0)
+    {
+        _file = fopen(file_name.c_str(), "wb");
+        if (_file == NULL)
+        {
+            throw Exception("Cannot open file %s for writing", file_name.c_str());
+        }
+    }
+    ~ref_index_writer_t() { if (_file != NULL) fclose(_file); }
+
+    /** writes the block at the current offset, returns this offset */
+    uint64_t write(const void* block, uint64_t size)
+    {
+        uint64_t block_offset = _offset;
+        if (size > 0 && fwrite(block, 1, size, _file) != size) error();
+        _offset += size;
+
+        static const char padding[8] = {0,0,0,0,0,0,0,0};
+        uint64_t padding_size = (8 - _offset % 8) % 8;
+        if (padding_size > 0 && fwrite(padding, 1, padding_size, _file) != padding_size) error();
+        _offset += padding_size;
+        return block_offset;
+    }
+
+    void rewrite_header(const ref_index_header_t& header)
+    {
+        if (fseek(_file, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), _file) != sizeof(header)) error();
+        if (fclose(_file) != 0) { _file = NULL; error(); }
+        _file = NULL;
+    }
+
+private:
+    void error() { throw Exception("Error while writing the reference index %s", _file_name.c_str()); }
+
+    string _file_name;
+    FILE* _file;
+    uint64_t _offset;
+};
+
+// code of the nucleotides, 4 for the other characters
+static inline int nt_code(char c)
+{
+    switch (c)
+    {
+        case 'A': case 'a': return 0;
+        case 'C': case 'c': return 1;
+        case 'G': case 'g': return 2;
+        case 'T': case 't': return 3;
+        default: return 4;
+    }
+}
+
+void RefIndex::write(const string& file_name, IBank* ref_bank, const string& ref_file_name, size_t kmer_size, int het_max_occ,
+                     const u_int8_t* bloom_array, u_int64_t bloom_byte_size, u_int64_t bloom_bit_size, size_t bloom_nb_hash)
+{
+    ref_index_writer_t writer(file_name);
+
+    ref_index_header_t header;
+    memset(&header, 0, sizeof(header));
+    writer.write(&header, sizeof(header)); // written again at the end
+
+    vector<ref_index_sequence_t> sequences;
+    string names;
+    vector<unsigned char> packed;
+    vector<ref_index_run_t> runs;
+    vector<ref_index_run_t> lower;
+
+    Iterator<Sequence>* it_seq = ref_bank->iterator();
+    LOCAL(it_seq);
+    for (it_seq->first(); !it_seq->isDone(); it_seq->next())
+    {
+        const char* seq = (*it_seq)->getDataBuffer();
+        uint64_t length = (*it_seq)->getDataSize();
+
+        packed.assign((length + 3) / 4, 0);
+        runs.clear();
+        lower.clear();
+        for (uint64_t i = 0; i < length; i++)
+        {
+            char c = seq[i];
+            int code = nt_code(c);
+            if (code < 4)
+            {
+                packed[i / 4] |= code << (2 * (i % 4));
+            }
+            else
+            {
+                char upper = toupper(c);
+                if (!runs.empty() && runs.back().start + runs.back().length == i && (char) runs.back().character == upper)
+                {
+                    runs.back().length++;
+                }
+                else
+                {
+                    ref_index_run_t run = {i, 1, (uint64_t) (unsigned char) upper};
+                    runs.push_back(run);
+                }
+            }
+            if (islower(c))
+            {
+                if (!lower.empty() && lower.back().start + lower.back().length == i)
+                {
+                    lower.back().length++;
+                }
+                else
+                {
+                    ref_index_run_t run = {i, 1, 0};
+                    lower.push_back(run);
+                }
+            }
+        }
+
+        ref_index_sequence_t sequence;
+        string name = (*it_seq)->getCommentShort();
+        sequence.name_offset = names.size(); // relative until the names are written
+        sequence.name_length = name.size();
+        names += name;
+        sequence.length = length;
+        sequence.packed_offset = writer.write(packed.data(), packed.size());
+        sequence.runs_offset = writer.write(runs.data(), runs.size() * sizeof(ref_index_run_t));
+        sequence.nb_runs = runs.size();
+        sequence.lower_offset = writer.write(lower.data(), lower.size() * sizeof(ref_index_run_t));
+        sequence.nb_lower = lower.size();
+        sequences.push_back(sequence);
+
+        header.total_length += length;
+    }
+
+    uint64_t names_offset = writer.write(names.data(), names.size());
+    for (size_t i = 0; i < sequences.size(); i++)
+    {
+        sequences[i].name_offset += names_offset;
+    }
+
+    memcpy(header.magic, REF_INDEX_MAGIC, sizeof(header.magic));
+    header.version = REF_INDEX_VERSION;
+    header.kmer_size = kmer_size;
+    header.het_max_occ = het_max_occ;
+    header.nb_sequences = sequences.size();
+    header.sequences_offset = writer.write(sequences.data(), sequences.size() * sizeof(ref_index_sequence_t));
+    header.ref_name_offset = writer.write(ref_file_name.data(), ref_file_name.size());
+    header.ref_name_length = ref_file_name.size();
+    header.bloom_offset = writer.write(bloom_array, bloom_byte_size);
+    header.bloom_byte_size = bloom_byte_size;
+    header.bloom_bit_size = bloom_bit_size;
+    header.bloom_nb_hash = bloom_nb_hash;
+
+    writer.rewrite_header(header);
+}
+
+RefIndex::RefIndex(const string& file_name) : _data(NULL), _data_size(0), _header(NULL), _sequences(NULL), _file_name(file_name)
+{
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw Exception("Cannot open reference index %s", file_name.c_str());
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || (size_t) file_stat.st_size < sizeof(ref_index_header_t))
+    {
+        close(fd);
+        throw Exception("Reference index %s : not a MindTheGap reference index", file_name.c_str());
+    }
+    _data_size = file_stat.st_size;
+    void* mapping = mmap(NULL, _data_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw Exception("Cannot map reference index %s", file_name.c_str());
+    }
+    _data = (const char*) mapping;
+    _header = (const ref_index_header_t*) _data;
+
+    // checking that the file is complete, before reading anything from it
+    bool valid = memcmp(_header->magic, REF_INDEX_MAGIC, sizeof(_header->magic)) == 0 && _header->version == REF_INDEX_VERSION
+        && _header->sequences_offset + _header->nb_sequences * sizeof(ref_index_sequence_t) <= _data_size
+        && _header->ref_name_offset + _header->ref_name_length <= _data_size
+        && _header->bloom_offset + _header->bloom_byte_size <= _data_size;
+    if (valid)
+    {
+        _sequences = (const ref_index_sequence_t*) (_data + _header->sequences_offset);
+        for (size_t i = 0; i < _header->nb_sequences && valid; i++)
+        {
+            const ref_index_sequence_t& sequence = _sequences[i];
+            valid = sequence.name_offset + sequence.name_length <= _data_size
+                && sequence.packed_offset + (sequence.length + 3) / 4 <= _data_size
+                && sequence.runs_offset + sequence.nb_runs * sizeof(ref_index_run_t) <= _data_size
+                && sequence.lower_offset + sequence.nb_lower * sizeof(ref_index_run_t) <= _data_size;
+        }
+    }
+    if (!valid)
+    {
+        munmap((void*) _data, _data_size);
+        throw Exception("Reference index %s : not a MindTheGap reference index, or written by another version", file_name.c_str());
+    }
+}
+
+RefIndex::~RefIndex()
+{
+    munmap((void*) _data, _data_size);
+}
+
+// the 4 nt of each possible byte of a packed sequence
+struct unpacked_bytes_t
+{
+    char nt[256][4];
+
+    unpacked_bytes_t()
+    {
+        static const char code_nt[4] = {'A','C','G','T'};
+        for (int b = 0; b < 256; b++)
+        {
+            for (int j = 0; j < 4; j++) nt[b][j] = code_nt[(b >> (2*j)) & 3];
+        }
+    }
+};
+
+void RefIndex::get_n_runs(size_t i, std::vector<tuple<uint64_t,uint64_t> >& n_runs) const
+{
+    n_runs.clear();
+
+    const ref_index_sequence_t& sequence = _sequences[i];
+    const ref_index_run_t* runs = (const ref_index_run_t*) (_data + sequence.runs_offset);
+    for (uint64_t r = 0; r < sequence.nb_runs; r++)
+    {
+        if (runs[r].character != 'N' || runs[r].start + runs[r].length > sequence.length) continue;
+        n_runs.push_back(tuple<uint64_t,uint64_t>(runs[r].start, runs[r].start + runs[r].length));
+    }
+}
+
+void RefIndex::get_sequence(size_t i, string& data) const
+{
+    static const unpacked_bytes_t unpacked;
+
+    const ref_index_sequence_t& sequence = _sequences[i];
+    const unsigned char* packed = (const unsigned char*) (_data + sequence.packed_offset);
+
+    data.resize(sequence.length);
+    uint64_t nb_full = sequence.length / 4;
+    for (uint64_t b = 0; b < nb_full; b++)
+    {
+        memcpy(&data[4*b], unpacked.nt[packed[b]], 4);
+    }
+    for (uint64_t j = 4*nb_full; j < sequence.length; j++)
+    {
+        data[j] = unpacked.nt[packed[nb_full]][j - 4*nb_full];
+    }
+
+    const ref_index_run_t* runs = (const ref_index_run_t*) (_data + sequence.runs_offset);
+    for (uint64_t r = 0; r < sequence.nb_runs; r++)
+    {
+        if (runs[r].start + runs[r].length > sequence.length) continue;
+        memset(&data[runs[r].start], (char) runs[r].character, runs[r].length);
+    }
+    const ref_index_run_t* lower = (const ref_index_run_t*) (_data + sequence.lower_offset);
+    for (uint64_t r = 0; r < sequence.nb_lower; r++)
+    {
+        if (lower[r].start + lower[r].length > sequence.length) continue;
+        for (uint64_t j = lower[r].start; j < lower[r].start + lower[r].length; j++)
+        {
+            data[j] = tolower(data[j]);
+        }
+    }
+}
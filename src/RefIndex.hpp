@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *   MindTheGap: Integrated detection and assembly of insertion variants
+ *   A tool from the GATB (Genome Assembly Tool Box)
+ *   Copyright (C) 2014  INRIA
+ *   Authors: C.Lemaitre, G.Rizk
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef _RefIndex_HPP_
+#define _RefIndex_HPP_
+
+#include <gatb/gatb_core.hpp>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <stdint.h>
+
+using namespace std;
+
+/** Header of a reference index file, all the numbers are 64 bits in the byte order of the machine that wrote it,
+ * the offsets are from the beginning of the file and multiples of 8
+ */
+struct ref_index_header_t
+{
+    char magic[8];
+    uint64_t version;
+    uint64_t kmer_size; // the repeat Bloom contains (kmer_size-1)-mers
+    uint64_t het_max_occ; // the repeat Bloom contains the (k-1)-mers occurring more than het_max_occ times
+    uint64_t nb_sequences;
+    uint64_t total_length;
+    uint64_t sequences_offset; // table of nb_sequences ref_index_sequence_t
+    uint64_t ref_name_offset; // name of the fasta file of the reference
+    uint64_t ref_name_length;
+    uint64_t bloom_offset;
+    uint64_t bloom_byte_size;
+    uint64_t bloom_bit_size; // parameters given to the BloomFactory to build the Bloom
+    uint64_t bloom_nb_hash;
+};
+
+/** One sequence of the reference in the index file
+ */
+struct ref_index_sequence_t
+{
+    uint64_t name_offset;
+    uint64_t name_length;
+    uint64_t length;
+    uint64_t packed_offset; // 2 bits per nt (A=0 C=1 G=2 T=3), 4 nt per byte, first nt in the low bits
+    uint64_t runs_offset; // table of nb_runs ref_index_run_t, the stretches of a same non ACGT character (packed as A)
+    uint64_t nb_runs;
+    uint64_t lower_offset; // table of nb_lower ref_index_run_t (character unused), the stretches of lowercase characters
+    uint64_t nb_lower;
+};
+
+struct ref_index_run_t
+{
+    uint64_t start;
+    uint64_t length;
+    uint64_t character;
+};
+
+/**
+ * Reference genome prepared once by MindTheGap index for the find module : the sequences, 2-bit packed with what is needed
+ * to give back their exact text, and the Bloom of the repeated (k-1)-mers, otherwise counted again at each find run (see FindBreakpoints::fillRefBloom).
+ * The file is memory-mapped, the sequences are decoded one at a time.
+ */
+class RefIndex
+{
+public:
+
+    /** maps the given index file, throws an Exception if it is not a valid one */
+    RefIndex(const string& file_name);
+    ~RefIndex();
+
+    /** writes the index of the sequences of ref_bank, with the content of the repeat Bloom built with the given parameters
+     */
+    static void write(const string& file_name, IBank* ref_bank, const string& ref_file_name, size_t kmer_size, int het_max_occ,
+                      const u_int8_t* bloom_array, u_int64_t bloom_byte_size, u_int64_t bloom_bit_size, size_t bloom_nb_hash);
+
+    size_t kmer_size() const { return _header->kmer_size; }
+    int het_max_occ() const { return (int) _header->het_max_occ; }
+    u_int64_t total_length() const { return _header->total_length; }
+    string ref_file_name() const { return string(_data + _header->ref_name_offset, _header->ref_name_length); }
+
+    size_t nb_sequences() const { return _header->nb_sequences; }
+    string sequence_name(size_t i) const { return string(_data + _sequences[i].name_offset, _sequences[i].name_length); }
+
+    /** decodes the i-th sequence, as it was in the fasta file */
+    void get_sequence(size_t i, string& data) const;
+
+    /** the stretches [start,end) of N of the i-th sequence (whatever their case), from the runs table, sorted */
+    void get_n_runs(size_t i, std::vector<tuple<uint64_t,uint64_t> >& n_runs) const;
+
+    /** creates the Bloom of the repeated (k-1)-mers of the reference, as it was built by MindTheGap index
+     */
+    template<size_t span>
+    IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* create_repeat_bloom() const;
+
+private:
+
+    const char* _data;
+    size_t _data_size;
+    const ref_index_header_t* _header;
+    const ref_index_sequence_t* _sequences;
+    string _file_name;
+};
+
+template<size_t span>
+IBloom<typename gatb::core::kmer::impl::Kmer<span>::Type>* RefIndex::create_repeat_bloom() const
+{
+    typedef typename gatb::core::kmer::impl::Kmer<span>::Type KmerType;
+
+    IBloom<KmerType>* bloom = BloomFactory::singleton().createBloom<KmerType> (BLOOM_CACHE, _header->bloom_bit_size, _header->bloom_nb_hash, _header->kmer_size-1);
+    if (bloom->getSize() != _header->bloom_byte_size)
+    {
+        delete bloom;
+        throw Exception("Reference index %s : its Bloom does not have the expected size (built with another gatb-core version ?)", _file_name.c_str());
+    }
+    memcpy(bloom->getArray(), _data + _header->bloom_offset, _header->bloom_byte_size);
+    return bloom;
+}
+
+#endif /* _RefIndex_HPP_ */
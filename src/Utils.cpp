@@ -19,6 +19,7 @@
  *****************************************************************************/
 
 #include <Utils.hpp>
+#include <climits>
 
 void revcomp_sequence(char s[], int len)
 {
@@ -84,106 +85,169 @@ int identNT(char a, char b)
 }
 
 
-float needleman_wunsch(string a, string b, int * nbmatch,int * nbmis,int * nbgaps)
+// scores of the alignment, in units of 5 (match 10, mismatch -5, gap -5)
+#define NW_MATCH 2
+#define NW_MISMATCH -1
+#define NW_GAP -1
+#define NW_NO_SCORE (INT_MIN/2)
+
+// first band tried, in number of gaps above the length difference
+#define NW_INITIAL_BAND 32
+
+static inline int floor_div2(int x) { return (x >= 0) ? x / 2 : -((-x + 1) / 2); }
+
+// smallest number of matches giving identity*100 >= identity_threshold, with the same float computation as the callers
+static int nw_min_matches(int max_len, int identity_threshold)
 {
-    float gap_score = -5;
-    float mismatch_score = -5;
-    float match_score = 10;
-#define nw_score(x,y) ( (x == y) ? match_score : mismatch_score )
+    int min_matches = (int) (((long) identity_threshold * max_len) / 100);
+    if (min_matches < 0) min_matches = 0;
+    while (min_matches > 0 && ((float) (min_matches-1) / max_len) * 100 >= identity_threshold) min_matches--;
+    while (min_matches <= max_len && ((float) min_matches / max_len) * 100 < identity_threshold) min_matches++;
+    return min_matches;
+}
 
+/*
+ * Needleman-Wunsch alignment restricted to the cells (i,j) such that |d|+|d-(n_a-n_b)| <= max_gaps, with d = i-j :
+ * the paths of this band are the alignments with at most max_gaps gaps.
+ * The traceback is the same as the one of the full matrix (diagonal first, then a[i-1] against a gap, then b[j-1] against a gap).
+ * returns the score of the best alignment of the band.
+ */
+static int nw_banded(const string& a, const string& b, int max_gaps, vector<int>& score, int& nb_match, int& nb_mis, int& nb_gaps)
+{
     int n_a = a.length(), n_b = b.length();
-    float ** score =  (float **) malloc (sizeof(float*) * (n_a+1));
-    for (int ii=0; ii<(n_a+1); ii++)
-    {
-        score [ii] = (float *) malloc (sizeof(float) * (n_b+1));
-    }
+    int delta = n_a - n_b;
+    int d_lo = -floor_div2(max_gaps - delta); // ceil((delta-max_gaps)/2)
+    int d_hi = floor_div2(delta + max_gaps);
+    int width = min(d_hi - d_lo + 1, n_b + 1);
 
-	// float score[n_a+1][n_b+1];  //stack is too small
-    // float pointer[n_a+1][n_b+1];
+    score.assign((size_t) (n_a+1) * width, NW_NO_SCORE);
 
-    for (int i = 0; i <= n_a; i++)
-        score[i][0] = gap_score * i;
-    for (int j = 0; j <= n_b; j++)
-        score[0][j] = gap_score * j;
+#define nw_first(i) max(0, (i) - d_hi)
+#define nw_last(i) min(n_b, (i) - d_lo)
+#define nw_cell(i,j) score[(size_t) (i) * width + (j) - nw_first(i)]
+#define nw_get(i,j) ( ((j) < nw_first(i) || (j) > nw_last(i)) ? NW_NO_SCORE : nw_cell(i,j) )
+#define nw_pair(x,y) ( (x == y) ? NW_MATCH : NW_MISMATCH )
 
-    // compute dp
-    for (int i = 1; i <= n_a; i++)
+    for (int i = 0; i <= n_a; i++)
     {
-        for (int j = 1; j <= n_b; j++)
+        for (int j = nw_first(i); j <= nw_last(i); j++)
         {
-            float match = score[i - 1][j - 1] + nw_score(a[i-1],b[j-1]);
-            float del =  score[i - 1][j] + gap_score;
-            float insert = score[i][j - 1] + gap_score;
-            score[i][j] = max( max(match, del), insert);
+            if (i == 0)
+                nw_cell(i,j) = NW_GAP * j;
+            else if (j == 0)
+                nw_cell(i,j) = NW_GAP * i;
+            else
+            {
+                int match = nw_get(i-1,j-1) + nw_pair(a[i-1],b[j-1]);
+                int del = nw_get(i-1,j) + NW_GAP;
+                int insert = nw_get(i,j-1) + NW_GAP;
+                nw_cell(i,j) = max( max(match, del), insert);
+            }
         }
     }
 
     // traceback
     int i=n_a, j=n_b;
-    float identity = 0;
-	int nb_mis = 0;
-	int nb_gaps = 0;
-
-	int nb_end_gaps = 0 ;
-	bool end_gap = true;
+    nb_match = 0;
+    nb_mis = 0;
+    nb_gaps = 0;
+    bool end_gap = true;
 
     while (i > 0 && j > 0)
     {
-
-        float score_current = score[i][j], score_diagonal = score[i-1][j-1], score_up = score[i][j-1], score_left = score[i-1][j];
-        if (score_current == score_diagonal + nw_score(a[i-1], b[j-1]))
+        int score_current = nw_cell(i,j);
+        if (score_current == nw_get(i-1,j-1) + nw_pair(a[i-1], b[j-1]))
         {
-            if (a[i-1]== b[j-1])
-			{
-
-                identity++;
-			}
-			else
-			{
-				nb_mis++;
-			}
+            if (a[i-1] == b[j-1])
+                nb_match++;
+            else
+                nb_mis++;
             i -= 1;
             j -= 1;
-
-
-			end_gap = false;
+            end_gap = false;
         }
         else
         {
-            if (score_current == score_left + gap_score)
-			{
-				i -= 1;
-			}
-            else if (score_current == score_up + gap_score)
-			{
-				j -= 1;
-			}
+            if (score_current == nw_get(i-1,j) + NW_GAP)
+                i -= 1;
+            else
+                j -= 1;
+
+            if (!end_gap) //pour ne pas compter gap terminal
+                nb_gaps++;
+        }
+    }
+    //pour compter gaps au debut  :
+    nb_gaps += i+j;
+
+#undef nw_first
+#undef nw_last
+#undef nw_cell
+#undef nw_get
+#undef nw_pair
+
+    return score[(size_t) n_a * width + n_b - max(0, n_a - d_hi)];
+}
 
+float needleman_wunsch(string a, string b, int * nbmatch,int * nbmis,int * nbgaps)
+{
+    return nw_identity(a, b, 0, nbmatch, nbmis, nbgaps);
+}
 
-			if(!end_gap) //pour ne pas compter gap terminal
-			{
+/*
+ * Any optimal alignment with G gaps has a score (in units of 5) of at most (n_a+n_b) - 2G : knowing the score S of one alignment,
+ * the optimal ones have at most (n_a+n_b-S)/2 gaps. The band is enlarged until it contains all of them, then the traceback is the one of the full matrix.
+ * With a threshold, the band is also limited to the alignments having enough matches : if the traceback of the full matrix reaches
+ * the threshold, it is in this band and it is found, otherwise the band gives a value below the threshold.
+ */
+float nw_identity(const string& a, const string& b, int identity_threshold, int * nbmatch, int * nbmis, int * nbgaps)
+{
+    int n_a = a.length(), n_b = b.length();
+    int max_len = max(n_a, n_b);
+    int delta = abs(n_a - n_b);
 
-				nb_gaps++;
-			}
+    // maximal number of gaps of an alignment with enough matches
+    int threshold_gaps = n_a + n_b;
+    int min_matches = 0;
+    if (identity_threshold > 0 && max_len > 0)
+    {
+        min_matches = nw_min_matches(max_len, identity_threshold);
+        threshold_gaps = n_a + n_b - 2 * min_matches;
+        if (threshold_gaps < delta)
+        {
+            // not enough nucleotides in the shortest sequence
+            return (float) min(n_a, n_b) / max_len;
         }
     }
 
-	//pour compter gaps au debut  :
-	nb_gaps += i+j;
-	//if(deb==1)printf("add gaps i j %i %i \n",i,j);
+    vector<int> score;
+    int nb_match = 0, nb_mis = 0, nb_gaps = 0;
+    int max_gaps = min(threshold_gaps, delta + NW_INITIAL_BAND);
+    for (;;)
+    {
+        int best_score = nw_banded(a, b, max_gaps, score, nb_match, nb_mis, nb_gaps);
+        int optimal_gaps = (n_a + n_b - best_score) / 2;
+
+        if (optimal_gaps <= max_gaps) break;
 
+        if (max_gaps == threshold_gaps)
+        {
+            if (nb_match < min_matches) break;
+            max_gaps = optimal_gaps;
+        }
+        else
+        {
+            max_gaps = min(optimal_gaps, threshold_gaps);
+        }
+    }
+
+    float identity = nb_match;
     identity /= max( n_a, n_b); // modif GR 27/09/2013    max of two sizes, otherwise free gaps
 
     if(nbmatch!=NULL) *nbmatch = identity;
     if(nbmis!=NULL)  *nbmis = nb_mis;
     if(nbgaps!=NULL) *nbgaps = nb_gaps;
 
-    for (int ii=0; ii<(n_a+1); ii++)
-    {
-        free (score [ii]);
-    }
-    free(score);
-
     //printf("---nw----\n%s\n%s -> %.2f\n--------\n",a.c_str(),b.c_str(),identity);
     return identity;
 }
@@ -196,7 +260,7 @@ bool all_consensuses_almost_identical(set<filled_insertion_t> consensuses, int i
         advance(it_b,1);
         while (it_b != consensuses.end())
         {
-            if (needleman_wunsch(it_a->seq,it_b->seq, NULL, NULL, NULL) * 100 < identity_threshold)
+            if (nw_identity(it_a->seq,it_b->seq, identity_threshold) * 100 < identity_threshold)
                 return false;
             advance(it_b,1);
         }
@@ -217,7 +281,7 @@ void remove_almost_identical_solutions(std::vector<filled_insertion_t>& consensu
     {
         bool found_a_similar_seq = false;
         for (std::vector<filled_insertion_t>::iterator it_b=final_set.begin(); it_b!=final_set.end(); ++it_b){
-            if (it_a->seq.compare(it_b->seq) == 0 || needleman_wunsch(it_a->seq,it_b->seq, NULL, NULL, NULL) * 100 >= identity_threshold){ // time optimisation ? if identical sequences, will not run needleman
+            if (it_a->seq.compare(it_b->seq) == 0 || nw_identity(it_a->seq,it_b->seq, identity_threshold) * 100 >= identity_threshold){ // time optimisation ? if identical sequences, will not run needleman
 
                 //This insertion is removed, but we select the one with nb_errors_in_anchor minimal
                 if(it_a->nb_errors_in_anchor < it_b->nb_errors_in_anchor){
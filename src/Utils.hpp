@@ -117,6 +117,13 @@ int identNT(char a, char b);
  */
 float needleman_wunsch(string a, string b, int * nbmatch,int * nbmis,int * nbgaps);
 
+/**
+ * identity of the needleman_wunsch alignment (same value), computed in a band of the dynamic programming matrix, enlarged only when needed
+ * if identity_threshold > 0 (percent), the computation stops as soon as the identity cannot reach it : the value returned is then below the threshold but not necessarily the exact identity
+ * (nor the values of nbmatch, nbmis and nbgaps)
+ */
+float nw_identity(const string& a, const string& b, int identity_threshold = 0, int * nbmatch = NULL, int * nbmis = NULL, int * nbgaps = NULL);
+
 
 
 
@@ -21,6 +21,7 @@
 // We include the header file for the tool
 #include <Finder.hpp>
 #include <Filler.hpp>
+#include <Indexer.hpp>
 
 /********************************************************************************/
 
@@ -30,6 +31,7 @@ static const char* MTG_VERSION = "2.2.1";
 
 static const char* STR_FIND        = "find";
 static const char* STR_FILL = "fill";
+static const char* STR_INDEX = "index";
 
 void displayVersion(std::ostream& os){
 
@@ -46,11 +48,14 @@ void displayHelp(std::ostream& os){
     os << "Usage: MindTheGap <module> [module options]" <<endl << endl;
     os << "[MindTheGap modules]" << endl;
     os << "    find     :    insertion breakpoint detection" << endl;
-    os << "                  usage: MindTheGap find (-in <reads.fq> | -graph <graph.h5>) -ref <reference.fa> [options]" << endl;
+    os << "                  usage: MindTheGap find (-in <reads.fq> | -graph <graph.h5>) (-ref <reference.fa> | -ref-index <reference.ref-index>) [options]" << endl;
     os << "                  help: MindTheGap find -help"<< endl;
     os << "    fill     :    gap-filler or insertion assembly"<< endl;
     os << "                  usage: MindTheGap fill (-in <reads.fq> | -graph <graph.h5>) (-bkpt <breakpoints.fa> | -contig <contig.fa>) [options]" << endl;
     os << "                  help: MindTheGap fill -help"<< endl;
+    os << "    index    :    reference genome index, to be reused by several find runs (option -ref-index)"<< endl;
+    os << "                  usage: MindTheGap index -ref <reference.fa> [options]" << endl;
+    os << "                  help: MindTheGap index -help"<< endl;
     os << "[Common options]" << endl;
     os << "    -help    :    display this help menu" << endl;
     os << "    -version :    display current version" << endl;
@@ -78,9 +83,9 @@ int main (int argc, char* argv[])
         return EXIT_SUCCESS;
     }
 
-    if ((strcmp(argv[1],STR_FIND) != 0 && strcmp(argv[1],STR_FILL) != 0 ) || (strcmp(argv[1],STR_FIND) == 0 && strcmp(argv[1],STR_FILL) == 0 ))
+    if (strcmp(argv[1],STR_FIND) != 0 && strcmp(argv[1],STR_FILL) != 0 && strcmp(argv[1],STR_INDEX) != 0)
     {
-        cerr << "options find and fill are incompatible, but at least one of these is mandatory" << endl;
+        cerr << "options find, fill and index are incompatible, but at least one of these is mandatory" << endl;
         return EXIT_FAILURE;
 
     }
@@ -119,6 +124,23 @@ int main (int argc, char* argv[])
             }
         }
 
+    if (strcmp(argv[1],STR_INDEX) == 0)
+        {
+            try
+            {
+                Indexer indexer = Indexer();
+                indexer._mtg_version = MTG_VERSION;
+                indexer.run (argc-1, argv+1);
+            }
+            catch (Exception& e)
+            {
+                if(strcmp(e.getMessage(),"")!=0){
+                    std::cout << std::endl << "EXCEPTION: " << e.getMessage() << std::endl;
+                }
+                return EXIT_FAILURE;
+            }
+        }
+
     return EXIT_SUCCESS;
 
 }
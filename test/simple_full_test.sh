@@ -118,6 +118,72 @@ echo "full-test find breakpoints with bed otpion : FAILED"
 RETVAL=1
 fi
 
+################################################################################
+# we launch the find module with tiny reference chunks (hidden option -chunk-size), with and without bed option :
+# the results must be the same as with a single chunk per sequence
+################################################################################
+${bindir}/MindTheGap find -graph $outputPrefix.h5 -ref ../data/reference.fasta -chunk-size 50 -out ${outputPrefix}_chunks >${outputPrefix}_chunks.out -nb-cores 4 2> /dev/null
+${bindir}/MindTheGap find -graph $outputPrefix.h5 -ref ../data/reference.fasta -bed ${goldPrefix}.bed -chunk-size 50 -out ${outputPrefix}_bed_chunks >${outputPrefix}_bed_chunks.out -nb-cores 4 2> /dev/null
+
+for suffix in "" "_bed"
+do
+    diff ${outputPrefix}${suffix}.breakpoints ${outputPrefix}${suffix}_chunks.breakpoints 1> /dev/null 2>&1
+    var=$?
+    sh compare_vcf.sh ${outputPrefix}${suffix}.othervariants.vcf ${outputPrefix}${suffix}_chunks.othervariants.vcf 1> /dev/null 2>&1
+    var2=$?
+
+    if [ $var -eq 0 ] && [ $var2 -eq 0 ]
+    then
+    echo "full-test find with small chunks${suffix} : PASS"
+    else
+    echo "full-test find with small chunks${suffix} : FAILED"
+    RETVAL=1
+    fi
+done
+
+################################################################################
+# we launch the index module, then the find module with the reference index :
+# the results must be the same as with the reference file
+################################################################################
+${bindir}/MindTheGap index -ref ../data/reference.fasta -out ${outputPrefix}_ref >${outputPrefix}_index.out 2> /dev/null
+${bindir}/MindTheGap find -graph $outputPrefix.h5 -ref-index ${outputPrefix}_ref.ref-index -out ${outputPrefix}_index >>${outputPrefix}_index.out -nb-cores 1 2> /dev/null
+
+diff $outputPrefix.breakpoints ${outputPrefix}_index.breakpoints 1> /dev/null 2>&1
+var=$?
+sh compare_vcf.sh $outputPrefix.othervariants.vcf ${outputPrefix}_index.othervariants.vcf 1> /dev/null 2>&1
+var2=$?
+
+if [ $var -eq 0 ] && [ $var2 -eq 0 ]
+then
+echo "full-test find with reference index : PASS"
+else
+echo "full-test find with reference index : FAILED"
+RETVAL=1
+fi
+
+################################################################################
+# we launch the find module with two graphs (here the same one twice) :
+# the results of each sample must be the same as the ones of a single-graph run
+################################################################################
+cp $outputPrefix.h5 $testDir/sample2.h5
+${bindir}/MindTheGap find -graph $outputPrefix.h5,$testDir/sample2.h5 -ref ../data/reference.fasta -out ${outputPrefix}_multi >${outputPrefix}_multi.out -nb-cores 1 2> /dev/null
+
+for sample in full-test sample2
+do
+    diff $outputPrefix.breakpoints ${outputPrefix}_multi_${sample}.breakpoints 1> /dev/null 2>&1
+    var=$?
+    sh compare_vcf.sh $outputPrefix.othervariants.vcf ${outputPrefix}_multi_${sample}.othervariants.vcf 1> /dev/null 2>&1
+    var2=$?
+
+    if [ $var -eq 0 ] && [ $var2 -eq 0 ]
+    then
+    echo "full-test find with 2 graphs, ${sample} : PASS"
+    else
+    echo "full-test find with 2 graphs, ${sample} : FAILED"
+    RETVAL=1
+    fi
+done
+
 ################################################################################
 # we launch the fill module
 ################################################################################
@@ -157,6 +223,99 @@ RETVAL=1
 fi
 
 
+################################################################################
+# we launch the fill module with a time limit that every gap-filling reaches :
+# all of them are reported as TIMEOUT in the info file, and no sequence is output
+################################################################################
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt $outputPrefix.breakpoints -max-time-per-gap 0.000000001 -out ${outputPrefix}_timeout -nb-cores 1 >>$outputPrefix.out 2> /dev/null
+
+nb_lines=$(cat ${outputPrefix}_timeout.info.txt | wc -l)
+nb_timeouts=$(grep -c "TIMEOUT$" ${outputPrefix}_timeout.info.txt)
+nb_variants=$(grep -v "^#" ${outputPrefix}_timeout.insertions.vcf | wc -l)
+
+if [ $nb_lines -gt 0 ] && [ $nb_timeouts -eq $nb_lines ] && [ ! -s ${outputPrefix}_timeout.insertions.fasta ] && [ $nb_variants -eq 0 ]
+then
+echo "full-test fill timeout     : PASS"
+else
+echo "full-test fill timeout     : FAILED"
+RETVAL=1
+fi
+
+################################################################################
+# we launch the fill module with the -bidirectional option, with an additional breakpoint whose right kmer is not in the graph :
+# the insertions are the same as without the option, and this breakpoint is reported as UNREACHABLE
+################################################################################
+cp $outputPrefix.breakpoints ${outputPrefix}_unreachable.breakpoints
+head -3 $outputPrefix.breakpoints | sed 's/^>bkpt/>unreachable/' >> ${outputPrefix}_unreachable.breakpoints
+echo "GATTACAGATTACAGATTACAGATTACAGAT" >> ${outputPrefix}_unreachable.breakpoints
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt ${outputPrefix}_unreachable.breakpoints -bidirectional -out ${outputPrefix}_bidirectional -nb-cores 1 >>$outputPrefix.out 2> /dev/null
+
+grep -v "^>" $outputPrefix.insertions.fasta > $outputPrefix.insertions.fasta.tmp
+grep -v "^>" ${outputPrefix}_bidirectional.insertions.fasta > ${outputPrefix}_bidirectional.insertions.fasta.tmp
+diff $outputPrefix.insertions.fasta.tmp ${outputPrefix}_bidirectional.insertions.fasta.tmp 1> /dev/null 2>&1
+var=$?
+grep -q "^unreachable.*UNREACHABLE$" ${outputPrefix}_bidirectional.info.txt
+var2=$?
+
+if [ $var -eq 0 ] && [ $var2 -eq 0 ]
+then
+echo "full-test fill bidirectional : PASS"
+else
+echo "full-test fill bidirectional : FAILED"
+RETVAL=1
+fi
+
+################################################################################
+# we launch the fill module with the -stop-at-target option :
+# some insertions are found, all of them are found without the option (only longer alternative sequences may be missed)
+################################################################################
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt $outputPrefix.breakpoints -stop-at-target -out ${outputPrefix}_stop -nb-cores 1 >>$outputPrefix.out 2> /dev/null
+
+grep -v "^>" $outputPrefix.insertions.fasta | sort -u > $outputPrefix.insertions.sorted.tmp
+grep -v "^>" ${outputPrefix}_stop.insertions.fasta | sort -u > ${outputPrefix}_stop.insertions.sorted.tmp
+nb_insertions=$(cat ${outputPrefix}_stop.insertions.sorted.tmp | wc -l)
+nb_new=$(comm -13 $outputPrefix.insertions.sorted.tmp ${outputPrefix}_stop.insertions.sorted.tmp | wc -l)
+
+if [ $nb_insertions -gt 0 ] && [ $nb_new -eq 0 ]
+then
+echo "full-test fill stop at target : PASS"
+else
+echo "full-test fill stop at target : FAILED"
+RETVAL=1
+fi
+
+################################################################################
+# we launch the fill module without the extension cache (-extension-cache 0), and with it on 1 and 4 cores,
+# with additional breakpoints sharing the left kmer of the first one : one with the right kmer of the second breakpoint, one with its own right kmer
+# the output files are the same with and without the cache
+################################################################################
+cp $outputPrefix.breakpoints ${outputPrefix}_shared.breakpoints
+head -3 $outputPrefix.breakpoints | sed 's/^>bkpt/>othertarget/' >> ${outputPrefix}_shared.breakpoints
+sed -n 8p $outputPrefix.breakpoints >> ${outputPrefix}_shared.breakpoints
+head -4 $outputPrefix.breakpoints | sed 's/^>bkpt/>sametarget/' >> ${outputPrefix}_shared.breakpoints
+
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt ${outputPrefix}_shared.breakpoints -extension-cache 0 -out ${outputPrefix}_nocache -nb-cores 1 >>$outputPrefix.out 2> /dev/null
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt ${outputPrefix}_shared.breakpoints -out ${outputPrefix}_cache -nb-cores 1 >>$outputPrefix.out 2> /dev/null
+${bindir}/MindTheGap fill -graph $outputPrefix.h5 -bkpt ${outputPrefix}_shared.breakpoints -out ${outputPrefix}_cache4 -nb-cores 4 >>$outputPrefix.out 2> /dev/null
+
+for run in cache cache4
+do
+    diff ${outputPrefix}_nocache.insertions.fasta ${outputPrefix}_${run}.insertions.fasta 1> /dev/null 2>&1
+    var=$?
+    diff ${outputPrefix}_nocache.info.txt ${outputPrefix}_${run}.info.txt 1> /dev/null 2>&1
+    var2=$?
+    sh compare_vcf.sh ${outputPrefix}_nocache.insertions.vcf ${outputPrefix}_${run}.insertions.vcf 1> /dev/null 2>&1
+    var3=$?
+
+    if [ $var -eq 0 ] && [ $var2 -eq 0 ] && [ $var3 -eq 0 ]
+    then
+    echo "full-test fill ${run} vs no cache : PASS"
+    else
+    echo "full-test fill ${run} vs no cache : FAILED"
+    RETVAL=1
+    fi
+done
+
 ################################################################################
 # we launch the fill module in contig mode
 ################################################################################
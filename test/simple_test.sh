@@ -78,6 +78,10 @@ output=$output"\n3-SNP*2 : "
 run_test_vcf reads/master.fasta references/multiSNP.fasta truths/multiSNP.vcf multiSNP "-snp-only" retvalue
 output=${output}${retvalue}
 
+output=$output"\n11-SNP-long-gap : "
+run_test_vcf reads/readref10K.fasta references/multiSNP_long.fasta truths/multiSNP_long.vcf multiSNP_long "-snp-only" retvalue
+output=${output}${retvalue}
+
 
 output=$output"\nsnp-before-clean-insert : "
 run_test reads/master.fasta references/deleted_before_SNP.fasta truths/insertion_before_SNP.fasta k-1_before_SNP "-no-deletion -homo-only" retvalue